@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+"""Benchmarks the Lox implementations in this repository on Linux.
+
+Builds VM.C, the C# tree-walk interpreter and the native FIB.C baseline, runs
+every benchmark in this directory against each of them and reports wall time,
+peak RSS and retired instructions as JSON. With --compare, medians are checked
+against a stored run and regressions fail the script.
+
+Every benchmark prints `true` as its last line when its result is correct; a
+run that prints anything else is reported as invalid instead of being timed.
+Peak RSS is measured by peakrss.c, which is built alongside the interpreters.
+"""
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCHMARKS = os.path.join(ROOT, "Benchmarks")
+DEFAULT_BUILD = os.path.join(BENCHMARKS, "build")
+
+# Benchmarks the native baseline implements, as (arguments, expected first
+# line of output).
+NATIVE = {
+    "Fib": (["30"], "832040"),
+}
+
+
+class Implementation:
+    def __init__(self, name, command, benchmarks=None):
+        self.name = name
+        self.command = command
+        self.benchmarks = benchmarks
+
+    def runs(self, benchmark):
+        return self.benchmarks is None or benchmark in self.benchmarks
+
+    def invocation(self, benchmark, path):
+        if self.benchmarks is None:
+            return self.command + [path]
+        arguments, _ = self.benchmarks[benchmark]
+        return self.command + arguments
+
+    def validate(self, benchmark, stdout):
+        lines = stdout.strip().splitlines()
+        if not lines:
+            return False
+        if self.benchmarks is None:
+            return lines[-1].strip() == "true"
+        _, expected = self.benchmarks[benchmark]
+        return lines[0].strip() == expected
+
+
+def log(message):
+    print(message, file=sys.stderr, flush=True)
+
+
+def build_peakrss(build):
+    output = os.path.join(build, "peakrss")
+    subprocess.run(
+        ["cc", "-O2", "-o", output, os.path.join(BENCHMARKS, "peakrss.c")],
+        check=True)
+    return output
+
+
+def build_vm(build):
+    output = os.path.join(build, "clox")
+    sources = sorted(
+        os.path.join(ROOT, "VM.C", name)
+        for name in os.listdir(os.path.join(ROOT, "VM.C"))
+        if name.endswith(".c"))
+    subprocess.run(
+        ["cc", "-std=c17", "-O2", "-DNDEBUG", "-D_DEFAULT_SOURCE", "-o", output]
+        + sources + ["-lm"],
+        check=True)
+    return Implementation("vm", [output])
+
+
+def build_native(build):
+    output = os.path.join(build, "fib")
+    subprocess.run(
+        ["cc", "-O2", "-o", output, os.path.join(ROOT, "FIB.C", "main.c")],
+        check=True)
+    return Implementation("native", [output], NATIVE)
+
+
+def build_tree(build):
+    if shutil.which("dotnet") is None:
+        log("Skipping tree: dotnet is not installed.")
+        return None
+
+    output = os.path.join(build, "tree")
+    subprocess.run(
+        ["dotnet", "build", os.path.join(ROOT, "Interpreter", "Interpreter.csproj"),
+         "-c", "Release", "-o", output, "-v", "q", "--nologo"],
+        check=True, stdout=subprocess.DEVNULL)
+    return Implementation("tree", ["dotnet", os.path.join(output, "lox.dll")])
+
+
+BUILDERS = {
+    "vm": build_vm,
+    "tree": build_tree,
+    "native": build_native,
+}
+
+
+def run_once(peakrss, command):
+    """Runs command, returning (seconds, peak RSS in KB, stdout, exit code)."""
+    with tempfile.NamedTemporaryFile("r") as rss:
+        start = time.perf_counter()
+        result = subprocess.run(
+            [peakrss, rss.name] + command,
+            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, cwd=BENCHMARKS)
+        elapsed = time.perf_counter() - start
+        peak = int(rss.read() or 0)
+    return elapsed, peak, result.stdout.decode(errors="replace"), result.returncode
+
+
+def count_instructions(command):
+    """Instruction counts barely vary between runs, so one run under perf is enough."""
+    if shutil.which("perf") is None:
+        return None
+
+    result = subprocess.run(
+        ["perf", "stat", "-x", ",", "-e", "instructions:u", "--"] + command,
+        stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, cwd=BENCHMARKS)
+    for line in result.stderr.decode(errors="replace").splitlines():
+        fields = line.split(",")
+        if len(fields) > 2 and fields[2].startswith("instructions") and fields[0].isdigit():
+            return int(fields[0])
+    return None
+
+
+def summarize(samples):
+    return {
+        "median": statistics.median(samples),
+        "mean": statistics.mean(samples),
+        "variance": statistics.variance(samples) if len(samples) > 1 else 0.0,
+        "stdev": statistics.stdev(samples) if len(samples) > 1 else 0.0,
+        "min": min(samples),
+        "max": max(samples),
+        "samples": samples,
+    }
+
+
+def measure(peakrss, implementation, benchmark, path, runs):
+    command = implementation.invocation(benchmark, path)
+    result = {"benchmark": benchmark, "implementation": implementation.name}
+
+    # The untimed first run also lets VM.C write its bytecode cache.
+    _, _, stdout, code = run_once(peakrss, command)
+    if code != 0 or not implementation.validate(benchmark, stdout):
+        log(f"  {benchmark}: invalid result (exit code {code})")
+        result["valid"] = False
+        return result
+
+    times = []
+    peak = 0
+    for _ in range(runs):
+        elapsed, rss, _, _ = run_once(peakrss, command)
+        times.append(elapsed)
+        peak = max(peak, rss)
+
+    result["valid"] = True
+    result["wall"] = summarize(times)
+    result["peakRssKb"] = peak
+    result["instructions"] = count_instructions(command)
+    log(f"  {benchmark}: {result['wall']['median']:.3f}s median, {peak} KB")
+    return result
+
+
+def git_commit():
+    try:
+        return subprocess.run(
+            ["git", "rev-parse", "HEAD"], cwd=ROOT, check=True,
+            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL).stdout.decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def compare(results, baseline, threshold):
+    """Prints median changes against baseline and returns the number of regressions."""
+    previous = {
+        (entry["benchmark"], entry["implementation"]): entry
+        for entry in baseline["results"] if entry.get("valid")
+    }
+
+    regressions = 0
+    for entry in results:
+        key = (entry["benchmark"], entry["implementation"])
+        if not entry.get("valid") or key not in previous:
+            continue
+
+        before = previous[key]["wall"]["median"]
+        after = entry["wall"]["median"]
+        change = (after - before) / before * 100
+
+        # Changes within twice the run-to-run spread are treated as noise.
+        noise = 2 * max(previous[key]["wall"]["stdev"], entry["wall"]["stdev"])
+        significant = abs(after - before) > noise
+
+        status = ""
+        if significant and change > threshold:
+            status = "  REGRESSION"
+            regressions += 1
+        elif significant and change < -threshold:
+            status = "  improvement"
+        log(f"{entry['implementation']:>6} {entry['benchmark']:<16} "
+            f"{before:8.3f}s -> {after:8.3f}s {change:+7.1f}%{status}")
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--runs", type=int, default=5, help="timed runs per benchmark")
+    parser.add_argument("--implementations", default="vm,tree,native",
+                        help="comma separated list of vm, tree and native")
+    parser.add_argument("--filter", default="", help="only run benchmarks containing this")
+    parser.add_argument("--build-dir", default=DEFAULT_BUILD)
+    parser.add_argument("--output", help="write results as JSON to this file")
+    parser.add_argument("--compare", metavar="BASELINE",
+                        help="compare medians against a previous --output file")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percent change in median reported as a regression")
+    args = parser.parse_args()
+
+    if platform.system() != "Linux":
+        parser.error("the benchmark harness only runs on Linux")
+
+    benchmarks = sorted(
+        name[:-len(".lox")] for name in os.listdir(BENCHMARKS)
+        if name.endswith(".lox") and args.filter in name)
+
+    os.makedirs(args.build_dir, exist_ok=True)
+    peakrss = build_peakrss(args.build_dir)
+    implementations = []
+    for name in args.implementations.split(","):
+        if name not in BUILDERS:
+            parser.error(f"unknown implementation '{name}'")
+        implementation = BUILDERS[name](args.build_dir)
+        if implementation is not None:
+            implementations.append(implementation)
+
+    results = []
+    for implementation in implementations:
+        log(f"{implementation.name}:")
+        for benchmark in benchmarks:
+            if implementation.runs(benchmark):
+                path = os.path.join(BENCHMARKS, benchmark + ".lox")
+                results.append(measure(peakrss, implementation, benchmark, path, args.runs))
+
+    report = {
+        "commit": git_commit(),
+        "machine": {
+            "system": platform.platform(),
+            "processor": platform.machine(),
+            "cpus": os.cpu_count(),
+        },
+        "runs": args.runs,
+        "results": results,
+    }
+
+    if args.output:
+        with open(args.output, "w") as file:
+            json.dump(report, file, indent=2)
+            file.write("\n")
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        print()
+
+    failed = sum(1 for entry in results if not entry["valid"])
+    if args.compare:
+        with open(args.compare) as file:
+            failed += compare(results, json.load(file), args.threshold)
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Runs a command and writes its peak RSS in KB to a file. A child forked from
+// the Python harness would report the harness's own RSS, because the kernel
+// carries the high-water mark across exec; forking from this small process
+// keeps the measurement to the command itself.
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: peakrss output command [arguments]\n");
+        return 64;
+    }
+
+    pid_t child = fork();
+    if (child < 0) return 71;
+
+    if (child == 0) {
+        execvp(argv[2], &argv[2]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) < 0) return 71;
+
+    FILE* output = fopen(argv[1], "w");
+    if (output == NULL) return 73;
+    fprintf(output, "%ld\n", usage.ru_maxrss);
+    fclose(output);
+
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
+}
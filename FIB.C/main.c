@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 
 int fib(int n) {
@@ -8,8 +9,10 @@ int fib(int n) {
 }
 
 int main(int argc, const char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 40;
+
     long before = clock();
-    printf("%d\n", fib(40));
+    printf("%d\n", fib(n));
     long after = clock();
     printf("0.%3d\n", after - before);
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+using Interpreter.Framework.Evaluating;
 using Interpreter.Framework.Scanning;
 
 namespace Interpreter.Framework.AST;
@@ -22,8 +23,10 @@ public abstract record class Expression
     public abstract T Accept<T>(IVisitor<T> visitor);
 }
 
-public record class AssignmentExpression(Token Name, Expression Value) : Expression
+public record class AssignmentExpression(Token Name, Expression Value) : Expression, IResolvable
 {
+    public (int distance, int slot)? Local { get; set; }
+
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitAssignmentExpression(this);
 }
 
@@ -39,6 +42,8 @@ public record class CallExpression(Expression Callee, Token Paren, List<Expressi
 
 public record class GetExpression(Expression LoxObject, Token Name) : Expression
 {
+    internal PropertyCache Cache { get; } = new();
+
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitGetExpression(this);
 }
 
@@ -59,16 +64,22 @@ public record class LogicalExpression(Expression Left, Token Operator, Expressio
 
 public record class SetExpression(Expression LoxObject, Token Name, Expression Value) : Expression
 {
+    internal PropertyCache Cache { get; } = new();
+
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitSetExpression(this);
 }
 
-public record class SuperExpression(Token Keyword, Token Method) : Expression
+public record class SuperExpression(Token Keyword, Token Method) : Expression, IResolvable
 {
+    public (int distance, int slot)? Local { get; set; }
+
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitSuperExpression(this);
 }
 
-public record class ThisExpression(Token Keyword) : Expression
+public record class ThisExpression(Token Keyword) : Expression, IResolvable
 {
+    public (int distance, int slot)? Local { get; set; }
+
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitThisExpression(this);
 }
 
@@ -77,7 +88,9 @@ public record class UnaryExpression(Token Operator, Expression Right) : Expressi
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitUnaryExpression(this);
 }
 
-public record class VariableExpression(Token Name) : Expression
+public record class VariableExpression(Token Name) : Expression, IResolvable
 {
+    public (int distance, int slot)? Local { get; set; }
+
     public override T Accept<T>(IVisitor<T> visitor) => visitor.VisitVariableExpression(this);
 }
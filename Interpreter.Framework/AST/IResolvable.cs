@@ -0,0 +1,8 @@
+﻿namespace Interpreter.Framework.AST;
+
+// An expression that names a variable. When the name refers to a local, the Resolver sets Local to how
+// many environments out the variable lives and its slot there. Globals leave it null.
+public interface IResolvable
+{
+    (int distance, int slot)? Local { get; set; }
+}
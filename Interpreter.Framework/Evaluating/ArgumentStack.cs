@@ -0,0 +1,33 @@
+﻿namespace Interpreter.Framework.Evaluating;
+
+// Argument values on their way to a callee. Calls nest, so they all share one stack: a call pushes its
+// arguments as it evaluates them and hands them over as a span, which the callee copies into its
+// environment before running anything that could push more.
+internal class ArgumentStack
+{
+    private LoxValue[] values = new LoxValue[64];
+    private int count = 0;
+
+    public int Count => count;
+
+    public void Push(LoxValue value)
+    {
+        if (count == values.Length)
+        {
+            Array.Resize(ref values, values.Length * 2);
+        }
+
+        values[count++] = value;
+    }
+
+    public ReadOnlySpan<LoxValue> From(int start) => new(values, start, count - start);
+
+    // Clears the popped values too, so the stack does not keep them alive.
+    public void PopTo(int start)
+    {
+        Array.Clear(values, start, count - start);
+        count = start;
+    }
+
+    public void Clear() => PopTo(0);
+}
@@ -4,14 +4,22 @@ using Interpreter.Framework.Scanning;
 using System.Diagnostics.CodeAnalysis;
 
 namespace Interpreter.Framework.Evaluating;
-public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<object?>
+public class AstInterpreter : Expression.IVisitor<LoxValue>, Statement.IVisitor<LoxValue>
 {
     private readonly Environment globals = new();
-    private readonly Dictionary<Expression, int> locals = new();
+    private readonly ArgumentStack arguments = new();
+
+    // Scan each program this interpreter runs with these names, so globals keep their Symbols between runs.
+    public NameTable Names { get; } = new();
     private Environment environment;
+    private readonly ClosureCompiler? compiler;
+    private readonly ExpressionTreeCompiler? treeCompiler;
 
-    public AstInterpreter()
+    public AstInterpreter(Backend backend = Backend.Visitor)
     {
+        if (backend == Backend.Closures) compiler = new ClosureCompiler(this, globals, arguments);
+        if (backend == Backend.ExpressionTrees) treeCompiler = new ExpressionTreeCompiler(this, globals, arguments);
+
         Reset();
     }
 
@@ -21,21 +29,33 @@ public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<o
         globals.Clear();
         environment = globals;
 
-        globals.Define("clock", new Clock());
-        globals.Define("reset", new Reset());
+        globals.Define(Symbol.For("clock"), new LoxValue(new Clock()));
+        globals.Define(Symbol.For("reset"), new LoxValue(new Reset()));
     }
 
     public LoxRuntimeError? Interpret(IEnumerable<Statement> statements)
     {
         try
         {
-            foreach (var statement in statements)
+            if (compiler != null)
+            {
+                foreach (var statement in compiler.Compile(statements))
+                {
+                    statement(globals);
+                }
+            }
+            else
             {
-                Execute(statement);
+                foreach (var statement in statements)
+                {
+                    Execute(statement);
+                }
             }
         }
         catch (LoxRuntimeError e)
         {
+            // The calls the error unwound never popped their arguments.
+            arguments.Clear();
             return e;
         }
 
@@ -43,16 +63,16 @@ public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<o
     }
 
     public event EventHandler<InterpreterOutEventArgs>? Out;
-    private void RaiseOut(string message) => Out?.Invoke(this, new InterpreterOutEventArgs(message));
+    internal void RaiseOut(string message) => Out?.Invoke(this, new InterpreterOutEventArgs(message));
 
     #region Expressions
-    public object? VisitAssignmentExpression(AssignmentExpression expression)
+    public LoxValue VisitAssignmentExpression(AssignmentExpression expression)
     {
         var value = Evaluate(expression.Value);
 
-        if (locals.TryGetValue(expression, out var distance))
+        if (expression.Local is { } local)
         {
-            environment.AssignAt(distance, expression.Name, value);
+            environment.AssignAt(local.distance, local.slot, value);
         }
         else
         {
@@ -62,123 +82,136 @@ public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<o
         return value;
     }
 
-    public object? VisitBinaryExpression(BinaryExpression expression)
+    public LoxValue VisitBinaryExpression(BinaryExpression expression)
     {
         var left = Evaluate(expression.Left);
         var right = Evaluate(expression.Right);
 
-        static object BinaryPlus(BinaryExpression expression, object? left, object? right)
+        switch (expression.Operator.Type)
         {
-            if (left is double lDbl && right is double rDbl) return lDbl + rDbl;
-            if (left is string lStr && right is string rStr) return lStr + rStr;
-            throw new LoxRuntimeError(expression.Operator, "Operands must be two numbers or two strings.");
+            case TokenType.PLUS: return Add(expression.Operator, left, right);
+            case TokenType.BANG_EQUAL: return !left.IsEqual(right);
+            case TokenType.EQUAL_EQUAL: return left.IsEqual(right);
         }
 
+        var (l, r) = CheckNumberOperands(expression.Operator, left, right);
+
         return expression.Operator.Type switch
         {
-            TokenType.PLUS => BinaryPlus(expression, left, right),
-            TokenType.MINUS => Functor.Minus(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.SLASH => Functor.Divide(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.STAR => Functor.Multiply(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.GREATER => Functor.Greater(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.GREATER_EQUAL => Functor.GreaterEqual(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.LESS => Functor.Less(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.LESS_EQUAL => Functor.LessEqual(CheckNumberOperands(expression.Operator, left, right)),
-            TokenType.BANG_EQUAL => !IsEqual(left, right),
-            TokenType.EQUAL_EQUAL => IsEqual(left, right),
+            TokenType.MINUS => l - r,
+            TokenType.SLASH => l / r,
+            TokenType.STAR => l * r,
+            TokenType.GREATER => l > r,
+            TokenType.GREATER_EQUAL => l >= r,
+            TokenType.LESS => l < r,
+            TokenType.LESS_EQUAL => l <= r,
             _ => throw new Exception($"unexpected token: '{expression.Operator}"), // impossible to hit
         };
     }
 
-    static class Functor
+    public LoxValue VisitCallExpression(CallExpression expression)
     {
-        public static Func<(double, double), double> Minus => ((double left, double right) operands) => operands.left - operands.right;
-        public static Func<(double, double), double> Divide => ((double left, double right) operands) => operands.left / operands.right;
-        public static Func<(double, double), double> Multiply => ((double left, double right) operands) => operands.left * operands.right;
-        public static Func<(double, double), bool> Greater => ((double left, double right) operands) => operands.left > operands.right;
-        public static Func<(double, double), bool> GreaterEqual => ((double left, double right) operands) => operands.left >= operands.right;
-        public static Func<(double, double), bool> Less => ((double left, double right) operands) => operands.left < operands.right;
-        public static Func<(double, double), bool> LessEqual => ((double left, double right) operands) => operands.left <= operands.right;
-    }
+        if (expression.Callee is GetExpression get) return Invoke(expression, get);
 
-    public object? VisitCallExpression(CallExpression expression)
-    {
         var callee = Evaluate(expression.Callee);
 
-        var arguments = expression.Arguments.Select(Evaluate).ToArray();
+        var start = PushArguments(expression.Arguments);
 
-        if (callee is ILoxCallable function)
+        return Call(expression.Paren, callee, start);
+    }
+
+    // Calls a method looked up on an instance without allocating the bound function.
+    private LoxValue Invoke(CallExpression expression, GetExpression get)
+    {
+        var loxObject = Evaluate(get.LoxObject);
+
+        if (loxObject.AsObject is not LoxInstance loxInstance)
         {
-            if (arguments.Length != function.Arity)
-            {
-                throw new LoxRuntimeError(expression.Paren, $"Expected {function.Arity} arguments but got {arguments.Length}.");
-            }
+            throw new LoxRuntimeError(get.Name, "Only instances have properties.");
+        }
 
-            return function.Call(this, arguments);
+        var cache = get.Cache;
+
+        if (cache.TryGetMethod(loxInstance, get.Name, out var method))
+        {
+            return Invoke(expression.Paren, method, loxInstance, PushArguments(expression.Arguments));
         }
-        else
+
+        var callee = cache.Get(loxInstance, get.Name);
+
+        return Call(expression.Paren, callee, PushArguments(expression.Arguments));
+    }
+
+    // Returns where the arguments start on the argument stack.
+    private int PushArguments(List<Expression> expressions)
+    {
+        var start = arguments.Count;
+
+        foreach (var expression in expressions)
         {
-            throw new LoxRuntimeError(expression.Paren, "Can only call functions and classes.");
+            arguments.Push(Evaluate(expression));
         }
+
+        return start;
     }
 
-    public object? VisitGetExpression(GetExpression expression)
+    public LoxValue VisitGetExpression(GetExpression expression)
     {
         var loxObject = Evaluate(expression.LoxObject);
-        if (loxObject is LoxInstance loxInstance)
+        if (loxObject.AsObject is LoxInstance loxInstance)
         {
-            return loxInstance.Get(expression.Name);
+            return expression.Cache.Get(loxInstance, expression.Name);
         }
 
         throw new LoxRuntimeError(expression.Name, "Only instances have properties.");
     }
 
-    public object? VisitGroupingExpression(GroupingExpression expression) => Evaluate(expression.Expression);
+    public LoxValue VisitGroupingExpression(GroupingExpression expression) => Evaluate(expression.Expression);
 
-    public object? VisitLiteralExpression(LiteralExpression expression) => expression.Value;
+    public LoxValue VisitLiteralExpression(LiteralExpression expression) => LoxValue.FromLiteral(expression.Value);
 
-    public object? VisitLogicalExpression(LogicalExpression expression)
+    public LoxValue VisitLogicalExpression(LogicalExpression expression)
     {
         var left = Evaluate(expression.Left);
 
         if (expression.Operator.Type == TokenType.OR)
         {
-            if (IsTruthy(left)) return left;
+            if (left.IsTruthy) return left;
         }
 
         if (expression.Operator.Type == TokenType.AND)
         {
-            if (!IsTruthy(left)) return left;
+            if (!left.IsTruthy) return left;
         }
 
         return Evaluate(expression.Right);
     }
 
-    public object? VisitSetExpression(SetExpression expression)
+    public LoxValue VisitSetExpression(SetExpression expression)
     {
         var loxObject = Evaluate(expression.LoxObject);
 
-        if (loxObject is LoxInstance loxInstance)
+        if (loxObject.AsObject is LoxInstance loxInstance)
         {
             var value = Evaluate(expression.Value);
-            loxInstance.Set(expression.Name, value);
+            expression.Cache.Set(loxInstance, expression.Name, value);
             return value;
         }
 
         throw new LoxRuntimeError(expression.Name, "Only instances have fields.");
     }
 
-    public object? VisitSuperExpression(SuperExpression expression)
+    public LoxValue VisitSuperExpression(SuperExpression expression)
     {
         // NOTE: the resolver prevents null references
-        var distance = locals[expression];
+        var (distance, slot) = expression.Local.GetValueOrDefault();
 #pragma warning disable CS8600 // Converting null literal or possible null value to non-nullable type.
-        var superLoxClass = (LoxClass)environment.GetAt(distance, LoxClass.SUPER);
-        var loxInstance = (LoxInstance)environment.GetAt(distance - 1, LoxInstance.THIS);
+        var superLoxClass = (LoxClass)environment.GetAt(distance, slot).AsObject;
+        var loxInstance = (LoxInstance)environment.GetAt(distance - 1, LoxInstance.THIS_SLOT).AsObject;
 #pragma warning restore CS8600
 
 #pragma warning disable CS8602 // Dereference of a possibly null reference.
-        superLoxClass.TryGetMethod(expression.Method.Lexeme, out var method);
+        superLoxClass.TryGetMethod(expression.Method.Symbol, out var method);
 #pragma warning restore CS8602
 
         if (method == null)
@@ -187,153 +220,148 @@ public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<o
         }
 
 #pragma warning disable CS8604 // Possible null reference argument.
-        return method.Bind(loxInstance);
+        return new LoxValue(method.Bind(loxInstance));
 #pragma warning restore CS8604
     }
 
-    public object? VisitThisExpression(ThisExpression expression) =>
+    public LoxValue VisitThisExpression(ThisExpression expression) =>
         LookUpVariable(expression.Keyword, expression);
 
-    public object? VisitUnaryExpression(UnaryExpression expression)
+    public LoxValue VisitUnaryExpression(UnaryExpression expression)
     {
         var right = Evaluate(expression.Right);
 
         return expression.Operator.Type switch
         {
             TokenType.MINUS => -CheckNumberOperand(expression.Operator, right),
-            TokenType.BANG => !IsTruthy(right),
+            TokenType.BANG => !right.IsTruthy,
             _ => throw new Exception($"unexpected token: '{expression.Operator}"), // impossible to hit
         };
     }
 
-    public object? VisitVariableExpression(VariableExpression expression) => LookUpVariable(expression.Name, expression);
+    public LoxValue VisitVariableExpression(VariableExpression expression) => LookUpVariable(expression.Name, expression);
     #endregion
 
     #region Statements
-    public object? VisitBlockStatement(BlockStatement statement)
+    public LoxValue VisitBlockStatement(BlockStatement statement)
     {
-        ExecuteBlock(statement.Statements, new Environment(environment));
-        return null;
+        return ExecuteBlock(statement.Statements, new Environment(environment));
     }
 
-    public object? VisitClassStatement(ClassStatement statement)
+    public LoxValue VisitClassStatement(ClassStatement statement)
     {
         LoxClass? superLoxClass = null;
         if (statement.SuperClass != null)
         {
-            var superClass = Evaluate(statement.SuperClass);
-
-            if (superClass is not LoxClass)
+            if (Evaluate(statement.SuperClass).AsObject is not LoxClass superClass)
             {
                 throw new LoxRuntimeError(statement.SuperClass.Name, "Super class must be a class.");
             }
 
-            superLoxClass = (LoxClass)superClass;
+            superLoxClass = superClass;
         }
 
-        environment.Define(statement.Name.Lexeme, null);
+        var enclosing = environment;
 
         if (superLoxClass != null)
         {
             environment = new Environment(environment);
-            environment.Define(LoxClass.SUPER, superLoxClass);
+            environment.Define(LoxClass.SUPER, new LoxValue(superLoxClass));
         }
 
-        var methods = new Dictionary<string, LoxFunction>();
+        var methods = new Dictionary<Symbol, LoxFunction>();
         foreach (var method in statement.Methods)
         {
-            var function = new LoxFunction(method, environment, LoxClass.IsInitializer(method.Name.Lexeme));
-            methods[method.Name.Lexeme] = function;
+            var function = new LoxFunction(method, environment, LoxClass.IsInitializer(method.Name.Symbol), treeCompiler?.Compile(method));
+            methods[method.Name.Symbol] = function;
         }
 
-        var loxClass = new LoxClass(statement.Name.Lexeme, superLoxClass, methods);
-        environment.Assign(statement.Name, loxClass);
+        environment = enclosing;
 
-        if (superLoxClass != null)
-        {
-#pragma warning disable CS8601 // Possible null reference assignment.
-            environment = environment.Enclosing;
-#pragma warning restore CS8601
-        }
-        return null;
+        // Methods only look the class up when called, so defining it last keeps its slot in declaration order.
+        enclosing.Define(statement.Name.Symbol, new LoxValue(new LoxClass(statement.Name.Lexeme, superLoxClass, methods)));
+        return Completion.Normal;
     }
 
-    public object? VisitExpressionStatement(ExpressionStatement statement)
+    public LoxValue VisitExpressionStatement(ExpressionStatement statement)
     {
         Evaluate(statement.Expression);
 
-        return null;
+        return Completion.Normal;
     }
 
-    public object? VisitFunctionStatement(FunctionStatement statement)
+    public LoxValue VisitFunctionStatement(FunctionStatement statement)
     {
-        var function = new LoxFunction(statement, environment, false);
+        var function = new LoxFunction(statement, environment, false, treeCompiler?.Compile(statement));
 
-        environment.Define(statement.Name.Lexeme, function);
+        environment.Define(statement.Name.Symbol, new LoxValue(function));
 
-        return null;
+        return Completion.Normal;
     }
 
-    public object? VisitIfStatement(IfStatement statement)
+    public LoxValue VisitIfStatement(IfStatement statement)
     {
-        if (IsTruthy(Evaluate(statement.Condition)))
+        if (Evaluate(statement.Condition).IsTruthy)
         {
-            Execute(statement.ThenBranch);
+            return Execute(statement.ThenBranch);
         }
         else if (statement.ElseBranch != null)
         {
-            Execute(statement.ElseBranch);
+            return Execute(statement.ElseBranch);
         }
 
-        return null;
+        return Completion.Normal;
     }
 
-    public object? VisitPrintStatement(PrintStatement statement)
+    public LoxValue VisitPrintStatement(PrintStatement statement)
     {
         var value = Evaluate(statement.Expression);
 
-        RaiseOut(Utilities.Stringify(value));
+        RaiseOut(value.ToString());
 
-        return null;
+        return Completion.Normal;
     }
 
-    public object? VisitReturnStatement(ReturnStatement statement)
+    public LoxValue VisitReturnStatement(ReturnStatement statement)
     {
-        object? value = null;
+        var value = LoxValue.Nil;
 
         if (statement.Value != null) value = Evaluate(statement.Value);
 
-        throw new Return(value);
+        return value;
     }
 
-    public object? VisitVariableStatement(VariableStatement statement)
+    public LoxValue VisitVariableStatement(VariableStatement statement)
     {
-        object? value = null;
+        var value = LoxValue.Nil;
 
         if (statement.Initializer != null) value = Evaluate(statement.Initializer);
 
-        environment.Define(statement.Name.Lexeme, value);
+        environment.Define(statement.Name.Symbol, value);
 
-        return null;
+        return Completion.Normal;
     }
 
-    public object? VisitWhileStatement(WhileStatement statement)
+    public LoxValue VisitWhileStatement(WhileStatement statement)
     {
-        while (IsTruthy(Evaluate(statement.Condition)))
+        while (Evaluate(statement.Condition).IsTruthy)
         {
-            Execute(statement.Body);
+            var completion = Execute(statement.Body);
+
+            if (!Completion.IsNormal(completion)) return completion;
         }
 
-        return null;
+        return Completion.Normal;
     }
     #endregion
 
     #region Helper Methods
-    private object? Evaluate(Expression expression) => expression.Accept(this);
+    private LoxValue Evaluate(Expression expression) => expression.Accept(this);
 
-    private void Execute(Statement statement) => statement.Accept(this);
+    // Statements return Completion.Normal, or the value of a return statement that has to unwind to its function.
+    private LoxValue Execute(Statement statement) => statement.Accept(this);
 
-    internal void ExecuteBlock(IEnumerable<Statement> statements, Environment environment)
+    internal LoxValue ExecuteBlock(IEnumerable<Statement> statements, Environment environment)
     {
         var previous = this.environment;
 
@@ -343,8 +371,12 @@ public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<o
 
             foreach (var statement in statements)
             {
-                Execute(statement);
+                var completion = Execute(statement);
+
+                if (!Completion.IsNormal(completion)) return completion;
             }
+
+            return Completion.Normal;
         }
         finally
         {
@@ -352,42 +384,68 @@ public class AstInterpreter : Expression.IVisitor<object?>, Statement.IVisitor<o
         }
     }
 
-    private static bool IsTruthy(object? obj) => obj switch
+    // Calls callee with the arguments pushed since start and pops them.
+    internal LoxValue Call(Token paren, LoxValue callee, int start)
     {
-        null => false,
-        bool boolean => boolean,
-        _ => true
-    };
+        if (callee.AsObject is not ILoxCallable function)
+        {
+            throw new LoxRuntimeError(paren, "Can only call functions and classes.");
+        }
+
+        var values = arguments.From(start);
+
+        CheckArity(paren, function, values.Length);
 
-    private static bool IsEqual(object? a, object? b)
+        var value = function.Call(this, values);
+        arguments.PopTo(start);
+        return value;
+    }
+
+    internal LoxValue Invoke(Token paren, LoxFunction method, LoxInstance loxInstance, int start)
+    {
+        var values = arguments.From(start);
+
+        CheckArity(paren, method, values.Length);
+
+        var value = method.Invoke(this, loxInstance, values);
+        arguments.PopTo(start);
+        return value;
+    }
+
+    private static void CheckArity(Token paren, ILoxCallable function, int count)
     {
-        if (a == null && b == null) return true;
-        if (a == null) return false;
+        if (count != function.Arity)
+        {
+            throw new LoxRuntimeError(paren, $"Expected {function.Arity} arguments but got {count}.");
+        }
+    }
 
-        return a.Equals(b);
+    internal static LoxValue Add(Token operation, LoxValue left, LoxValue right)
+    {
+        if (left.TryGetNumber(out var lDbl) && right.TryGetNumber(out var rDbl)) return lDbl + rDbl;
+        if (left.TryGetString(out var lStr) && right.TryGetString(out var rStr)) return lStr + rStr;
+        throw new LoxRuntimeError(operation, "Operands must be two numbers or two strings.");
     }
 
-    private static double CheckNumberOperand(Token operation, object? operand)
+    internal static double CheckNumberOperand(Token operation, LoxValue operand)
     {
-        if (operand is double dbl) return dbl;
+        if (operand.TryGetNumber(out var dbl)) return dbl;
 
         throw new LoxRuntimeError(operation, "Operand must be a number.");
     }
 
-    private static (double left, double right) CheckNumberOperands(Token operation, object? left, object? right)
+    internal static (double left, double right) CheckNumberOperands(Token operation, LoxValue left, LoxValue right)
     {
-        if (left is double lDbl && right is double rDbl) return (lDbl, rDbl);
+        if (left.TryGetNumber(out var lDbl) && right.TryGetNumber(out var rDbl)) return (lDbl, rDbl);
 
         throw new LoxRuntimeError(operation, "Operands must be numbers.");
     }
 
-    internal void Resolve(Expression expression, int depth) => locals[expression] = depth;
-
-    private object? LookUpVariable(Token name, Expression expression)
+    private LoxValue LookUpVariable(Token name, IResolvable expression)
     {
-        if (locals.TryGetValue(expression, out var distance))
+        if (expression.Local is { } local)
         {
-            return environment.GetAt(distance, name.Lexeme);
+            return environment.GetAt(local.distance, local.slot);
         }
         else
         {
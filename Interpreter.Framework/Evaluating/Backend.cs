@@ -0,0 +1,13 @@
+﻿namespace Interpreter.Framework.Evaluating;
+
+public enum Backend
+{
+    // Walks the AST with the Expression and Statement visitors.
+    Visitor,
+
+    // Compiles each statement once into closures specialized for its nodes.
+    Closures,
+
+    // Runs top-level code with the visitor and compiles function bodies to expression trees for the JIT.
+    ExpressionTrees,
+}
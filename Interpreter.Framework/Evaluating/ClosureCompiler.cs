@@ -0,0 +1,440 @@
+﻿using Interpreter.Framework.AST;
+using Interpreter.Framework.Scanning;
+
+namespace Interpreter.Framework.Evaluating;
+
+internal delegate LoxValue CompiledExpression(Environment environment);
+
+// Returns Completion.Normal, or the value of the return statement that ended the enclosing function.
+internal delegate LoxValue CompiledStatement(Environment environment);
+
+// Turns resolved statements into closures once, so running them does no visitor dispatch, no operator
+// switches and no lookups of resolver results. Runtime errors match the ones the visitor reports.
+internal class ClosureCompiler : Expression.IVisitor<CompiledExpression>, Statement.IVisitor<CompiledStatement>
+{
+    private readonly AstInterpreter interpreter;
+    private readonly Environment globals;
+    private readonly ArgumentStack argumentStack;
+
+    public ClosureCompiler(AstInterpreter interpreter, Environment globals, ArgumentStack argumentStack)
+    {
+        this.interpreter = interpreter;
+        this.globals = globals;
+        this.argumentStack = argumentStack;
+    }
+
+    public CompiledStatement[] Compile(IEnumerable<Statement> statements) => statements.Select(Compile).ToArray();
+
+    #region Expressions
+    public CompiledExpression VisitAssignmentExpression(AssignmentExpression expression)
+    {
+        var value = Compile(expression.Value);
+
+        if (expression.Local is { } local)
+        {
+            var (distance, slot) = local;
+
+            return environment =>
+            {
+                var result = value(environment);
+                environment.AssignAt(distance, slot, result);
+                return result;
+            };
+        }
+
+        var name = expression.Name;
+
+        return environment =>
+        {
+            var result = value(environment);
+            globals.Assign(name, result);
+            return result;
+        };
+    }
+
+    public CompiledExpression VisitBinaryExpression(BinaryExpression expression)
+    {
+        var left = Compile(expression.Left);
+        var right = Compile(expression.Right);
+        var operation = expression.Operator;
+
+        return operation.Type switch
+        {
+            TokenType.PLUS => environment => AstInterpreter.Add(operation, left(environment), right(environment)),
+            TokenType.MINUS => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l - r;
+            },
+            TokenType.SLASH => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l / r;
+            },
+            TokenType.STAR => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l * r;
+            },
+            TokenType.GREATER => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l > r;
+            },
+            TokenType.GREATER_EQUAL => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l >= r;
+            },
+            TokenType.LESS => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l < r;
+            },
+            TokenType.LESS_EQUAL => environment =>
+            {
+                var (l, r) = AstInterpreter.CheckNumberOperands(operation, left(environment), right(environment));
+                return l <= r;
+            },
+            TokenType.BANG_EQUAL => environment => !left(environment).IsEqual(right(environment)),
+            TokenType.EQUAL_EQUAL => environment => left(environment).IsEqual(right(environment)),
+            _ => throw new Exception($"unexpected token: '{expression.Operator}"), // impossible to hit
+        };
+    }
+
+    public CompiledExpression VisitCallExpression(CallExpression expression)
+    {
+        var arguments = expression.Arguments.Select(Compile).ToArray();
+        var paren = expression.Paren;
+
+        if (expression.Callee is GetExpression get) return Invoke(get, arguments, paren);
+
+        var callee = Compile(expression.Callee);
+
+        return environment =>
+        {
+            var function = callee(environment);
+
+            return interpreter.Call(paren, function, Push(arguments, environment));
+        };
+    }
+
+    // Calls a method looked up on an instance without allocating the bound function.
+    private CompiledExpression Invoke(GetExpression get, CompiledExpression[] arguments, Token paren)
+    {
+        var loxObject = Compile(get.LoxObject);
+        var name = get.Name;
+        var cache = get.Cache;
+
+        return environment =>
+        {
+            if (loxObject(environment).AsObject is not LoxInstance loxInstance)
+            {
+                throw new LoxRuntimeError(name, "Only instances have properties.");
+            }
+
+            if (cache.TryGetMethod(loxInstance, name, out var method))
+            {
+                return interpreter.Invoke(paren, method, loxInstance, Push(arguments, environment));
+            }
+
+            var callee = cache.Get(loxInstance, name);
+
+            return interpreter.Call(paren, callee, Push(arguments, environment));
+        };
+    }
+
+    public CompiledExpression VisitGetExpression(GetExpression expression)
+    {
+        var loxObject = Compile(expression.LoxObject);
+        var name = expression.Name;
+        var cache = expression.Cache;
+
+        return environment =>
+        {
+            if (loxObject(environment).AsObject is LoxInstance loxInstance) return cache.Get(loxInstance, name);
+
+            throw new LoxRuntimeError(name, "Only instances have properties.");
+        };
+    }
+
+    public CompiledExpression VisitGroupingExpression(GroupingExpression expression) => Compile(expression.Expression);
+
+    public CompiledExpression VisitLiteralExpression(LiteralExpression expression)
+    {
+        var value = LoxValue.FromLiteral(expression.Value);
+
+        return _ => value;
+    }
+
+    public CompiledExpression VisitLogicalExpression(LogicalExpression expression)
+    {
+        var left = Compile(expression.Left);
+        var right = Compile(expression.Right);
+
+        if (expression.Operator.Type == TokenType.OR)
+        {
+            return environment =>
+            {
+                var value = left(environment);
+                return value.IsTruthy ? value : right(environment);
+            };
+        }
+
+        return environment =>
+        {
+            var value = left(environment);
+            return value.IsTruthy ? right(environment) : value;
+        };
+    }
+
+    public CompiledExpression VisitSetExpression(SetExpression expression)
+    {
+        var loxObject = Compile(expression.LoxObject);
+        var value = Compile(expression.Value);
+        var name = expression.Name;
+        var cache = expression.Cache;
+
+        return environment =>
+        {
+            if (loxObject(environment).AsObject is LoxInstance loxInstance)
+            {
+                var result = value(environment);
+                cache.Set(loxInstance, name, result);
+                return result;
+            }
+
+            throw new LoxRuntimeError(name, "Only instances have fields.");
+        };
+    }
+
+    public CompiledExpression VisitSuperExpression(SuperExpression expression)
+    {
+        // NOTE: the resolver always resolves super, and this one scope inside it
+        var (distance, slot) = expression.Local.GetValueOrDefault();
+        var method = expression.Method;
+
+        return environment =>
+        {
+            var superLoxClass = (LoxClass)environment.GetAt(distance, slot).AsObject!;
+            var loxInstance = (LoxInstance)environment.GetAt(distance - 1, LoxInstance.THIS_SLOT).AsObject!;
+
+            if (superLoxClass.TryGetMethod(method.Symbol, out var function)) return new LoxValue(function.Bind(loxInstance));
+
+            throw new LoxRuntimeError(method, $"Undefined property '{method.Lexeme}'.");
+        };
+    }
+
+    public CompiledExpression VisitThisExpression(ThisExpression expression) => LookUpVariable(expression.Keyword, expression);
+
+    public CompiledExpression VisitUnaryExpression(UnaryExpression expression)
+    {
+        var right = Compile(expression.Right);
+        var operation = expression.Operator;
+
+        return operation.Type switch
+        {
+            TokenType.MINUS => environment => -AstInterpreter.CheckNumberOperand(operation, right(environment)),
+            TokenType.BANG => environment => !right(environment).IsTruthy,
+            _ => throw new Exception($"unexpected token: '{expression.Operator}"), // impossible to hit
+        };
+    }
+
+    public CompiledExpression VisitVariableExpression(VariableExpression expression) => LookUpVariable(expression.Name, expression);
+    #endregion
+
+    #region Statements
+    public CompiledStatement VisitBlockStatement(BlockStatement statement)
+    {
+        var statements = Compile(statement.Statements);
+
+        return environment => Run(statements, new Environment(environment));
+    }
+
+    public CompiledStatement VisitClassStatement(ClassStatement statement)
+    {
+        var name = statement.Name.Symbol;
+        var superClass = statement.SuperClass;
+        var superClassValue = superClass == null ? null : Compile(superClass);
+        var methods = statement.Methods
+            .Select(method => (declaration: method, body: CompileBody(method), isInitializer: LoxClass.IsInitializer(method.Name.Symbol)))
+            .ToArray();
+
+        return environment =>
+        {
+            LoxClass? superLoxClass = null;
+            var enclosing = environment;
+
+            if (superClass != null && superClassValue != null)
+            {
+                if (superClassValue(environment).AsObject is not LoxClass loxClass)
+                {
+                    throw new LoxRuntimeError(superClass.Name, "Super class must be a class.");
+                }
+
+                superLoxClass = loxClass;
+                environment = new Environment(environment);
+                environment.Define(LoxClass.SUPER, new LoxValue(superLoxClass));
+            }
+
+            var functions = new Dictionary<Symbol, LoxFunction>();
+            foreach (var (declaration, body, isInitializer) in methods)
+            {
+                functions[declaration.Name.Symbol] = new LoxFunction(declaration, environment, isInitializer, body);
+            }
+
+            enclosing.Define(name, new LoxValue(new LoxClass(name.Name, superLoxClass, functions)));
+            return Completion.Normal;
+        };
+    }
+
+    public CompiledStatement VisitExpressionStatement(ExpressionStatement statement)
+    {
+        var expression = Compile(statement.Expression);
+
+        return environment =>
+        {
+            expression(environment);
+            return Completion.Normal;
+        };
+    }
+
+    public CompiledStatement VisitFunctionStatement(FunctionStatement statement)
+    {
+        var name = statement.Name.Symbol;
+        var body = CompileBody(statement);
+
+        return environment =>
+        {
+            environment.Define(name, new LoxValue(new LoxFunction(statement, environment, false, body)));
+            return Completion.Normal;
+        };
+    }
+
+    public CompiledStatement VisitIfStatement(IfStatement statement)
+    {
+        var condition = Compile(statement.Condition);
+        var thenBranch = Compile(statement.ThenBranch);
+
+        if (statement.ElseBranch == null)
+        {
+            return environment => condition(environment).IsTruthy ? thenBranch(environment) : Completion.Normal;
+        }
+
+        var elseBranch = Compile(statement.ElseBranch);
+
+        return environment => condition(environment).IsTruthy ? thenBranch(environment) : elseBranch(environment);
+    }
+
+    public CompiledStatement VisitPrintStatement(PrintStatement statement)
+    {
+        var expression = Compile(statement.Expression);
+
+        return environment =>
+        {
+            interpreter.RaiseOut(expression(environment).ToString());
+            return Completion.Normal;
+        };
+    }
+
+    public CompiledStatement VisitReturnStatement(ReturnStatement statement)
+    {
+        if (statement.Value == null) return _ => LoxValue.Nil;
+
+        var value = Compile(statement.Value);
+
+        return environment => value(environment);
+    }
+
+    public CompiledStatement VisitVariableStatement(VariableStatement statement)
+    {
+        var name = statement.Name.Symbol;
+
+        if (statement.Initializer == null)
+        {
+            return environment =>
+            {
+                environment.Define(name, LoxValue.Nil);
+                return Completion.Normal;
+            };
+        }
+
+        var initializer = Compile(statement.Initializer);
+
+        return environment =>
+        {
+            environment.Define(name, initializer(environment));
+            return Completion.Normal;
+        };
+    }
+
+    public CompiledStatement VisitWhileStatement(WhileStatement statement)
+    {
+        var condition = Compile(statement.Condition);
+        var body = Compile(statement.Body);
+
+        return environment =>
+        {
+            while (condition(environment).IsTruthy)
+            {
+                var completion = body(environment);
+
+                if (!Completion.IsNormal(completion)) return completion;
+            }
+
+            return Completion.Normal;
+        };
+    }
+    #endregion
+
+    #region Helper Methods
+    private CompiledExpression Compile(Expression expression) => expression.Accept(this);
+
+    private CompiledStatement Compile(Statement statement) => statement.Accept(this);
+
+    // The function's environment is created by LoxFunction.Call, so the body runs directly in it.
+    private CompiledStatement CompileBody(FunctionStatement function)
+    {
+        var statements = Compile(function.Body);
+
+        return environment => Run(statements, environment);
+    }
+
+    // Returns where the arguments start on the argument stack.
+    private int Push(CompiledExpression[] arguments, Environment environment)
+    {
+        var start = argumentStack.Count;
+
+        foreach (var argument in arguments)
+        {
+            argumentStack.Push(argument(environment));
+        }
+
+        return start;
+    }
+
+    private static LoxValue Run(CompiledStatement[] statements, Environment environment)
+    {
+        foreach (var statement in statements)
+        {
+            var completion = statement(environment);
+
+            if (!Completion.IsNormal(completion)) return completion;
+        }
+
+        return Completion.Normal;
+    }
+
+    private CompiledExpression LookUpVariable(Token name, IResolvable expression)
+    {
+        if (expression.Local is { } local)
+        {
+            var (distance, slot) = local;
+
+            return environment => environment.GetAt(distance, slot);
+        }
+
+        return _ => globals.Get(name);
+    }
+    #endregion
+}
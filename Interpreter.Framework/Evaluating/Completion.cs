@@ -0,0 +1,8 @@
+﻿namespace Interpreter.Framework.Evaluating;
+internal static class Completion
+{
+    // Returned by statements that finish without running a return statement.
+    public static readonly LoxValue Normal = LoxValue.Sentinel();
+
+    public static bool IsNormal(LoxValue completion) => completion.IsIdentical(Normal);
+}
@@ -6,45 +6,72 @@ internal class Environment
 {
     public readonly Environment? Enclosing = null;
 
-    private readonly Dictionary<string, object?> values = new();
+    // Globals are looked up by name since they can be defined after the code that uses them is resolved.
+    // Locals never use the table, so they share one empty instance instead of allocating their own.
+    private static readonly Dictionary<Symbol, LoxValue> NoGlobals = new();
+    private readonly Dictionary<Symbol, LoxValue> values;
 
-    public Environment(Environment? enclosing = null) { Enclosing = enclosing; }
+    // Locals are stored in the order they are declared, which is the slot the Resolver gave them.
+    private LoxValue[] slots = Array.Empty<LoxValue>();
+    private int count = 0;
 
-    public void Clear() => values.Clear();
-
-    public void Define(string name, object? value) { values[name] = value; }
+    public Environment() { values = new(); }
 
-    public object? Get(Token name)
+    public Environment(Environment enclosing)
     {
-        if (values.TryGetValue(name.Lexeme, out object? value)) return value;
-
-        if (Enclosing != null) return Enclosing.Get(name);
+        Enclosing = enclosing;
+        values = NoGlobals;
+    }
 
-        throw UndefinedVariableError(name);
+    // Starts out with locals already defined, which take the first slots.
+    public Environment(Environment enclosing, ReadOnlySpan<LoxValue> locals) : this(enclosing)
+    {
+        slots = new LoxValue[Math.Max(4, locals.Length)];
+        locals.CopyTo(slots);
+        count = locals.Length;
     }
 
-    public object? GetAt(int distance, string name) =>
-        Ancestor(distance).values[name];
+    public void Clear() => values.Clear();
 
-    public void Assign(Token name, object? value)
+    public void Define(Symbol name, LoxValue value)
     {
-        if (values.TryGetValue(name.Lexeme, out object? _))
+        if (Enclosing == null)
         {
-            values[name.Lexeme] = value;
+            values[name] = value;
             return;
         }
 
-        if (Enclosing != null)
+        if (count == slots.Length)
+        {
+            Array.Resize(ref slots, Math.Max(4, slots.Length * 2));
+        }
+
+        slots[count++] = value;
+    }
+
+    public LoxValue Get(Token name)
+    {
+        if (values.TryGetValue(name.Symbol, out var value)) return value;
+
+        throw UndefinedVariableError(name);
+    }
+
+    public LoxValue GetAt(int distance, int slot) =>
+        Ancestor(distance).slots[slot];
+
+    public void Assign(Token name, LoxValue value)
+    {
+        if (values.ContainsKey(name.Symbol))
         {
-            Enclosing.Assign(name, value);
+            values[name.Symbol] = value;
             return;
         }
 
         throw UndefinedVariableError(name);
     }
 
-    public void AssignAt(int distance, Token name, object? value) =>
-        Ancestor(distance).Assign(name, value);
+    public void AssignAt(int distance, int slot, LoxValue value) =>
+        Ancestor(distance).slots[slot] = value;
 
     private static LoxRuntimeError UndefinedVariableError(Token name) => new(name, $"Undefined variable '{name.Lexeme}'.");
 
@@ -0,0 +1,411 @@
+﻿using Interpreter.Framework.AST;
+using Interpreter.Framework.Scanning;
+using System.Reflection;
+using LabelTarget = System.Linq.Expressions.LabelTarget;
+using ParameterExpression = System.Linq.Expressions.ParameterExpression;
+using Tree = System.Linq.Expressions.Expression;
+
+namespace Interpreter.Framework.Evaluating;
+
+// Lowers function bodies to System.Linq.Expressions trees and compiles them, so the JIT produces native
+// code for each Lox function. Values stay LoxValues in the same Environment slots the visitor uses,
+// and everything past plain control flow goes through the helpers at the bottom of this file.
+internal class ExpressionTreeCompiler : Expression.IVisitor<Tree>, Statement.IVisitor<Tree>
+{
+    private readonly AstInterpreter interpreter;
+    private readonly Environment globals;
+    private readonly ArgumentStack argumentStack;
+
+    // A body is compiled the first time its function is declared and shared by every closure over it.
+    private readonly Dictionary<FunctionStatement, CompiledStatement> bodies = new(ReferenceEqualityComparer.Instance);
+
+    // The function being lowered.
+    private ParameterExpression environment = Tree.Parameter(typeof(Environment));
+    private LabelTarget returnLabel = Tree.Label(typeof(LoxValue));
+
+    public ExpressionTreeCompiler(AstInterpreter interpreter, Environment globals, ArgumentStack argumentStack)
+    {
+        this.interpreter = interpreter;
+        this.globals = globals;
+        this.argumentStack = argumentStack;
+    }
+
+    public CompiledStatement Compile(FunctionStatement function)
+    {
+        if (bodies.TryGetValue(function, out var body)) return body;
+
+        var (enclosingEnvironment, enclosingReturnLabel) = (environment, returnLabel);
+        environment = Tree.Parameter(typeof(Environment), "environment");
+        returnLabel = Tree.Label(typeof(LoxValue), "return");
+
+        try
+        {
+            var statements = function.Body.Select(Lower).Append(Tree.Label(returnLabel, Tree.Constant(Completion.Normal)));
+            var lambda = Tree.Lambda<CompiledStatement>(Tree.Block(typeof(LoxValue), statements), function.Name.Lexeme, new[] { environment });
+
+            body = lambda.Compile();
+        }
+        finally
+        {
+            (environment, returnLabel) = (enclosingEnvironment, enclosingReturnLabel);
+        }
+
+        bodies[function] = body;
+        return body;
+    }
+
+    #region Expressions
+    public Tree VisitAssignmentExpression(AssignmentExpression expression)
+    {
+        var value = Tree.Variable(typeof(LoxValue), "value");
+
+        Tree assign = expression.Local is { } local
+            ? Tree.Call(environment, AssignAt, Tree.Constant(local.distance), Tree.Constant(local.slot), value)
+            : Tree.Call(Tree.Constant(globals), Assign, Tree.Constant(expression.Name), value);
+
+        return Tree.Block(typeof(LoxValue), new[] { value }, Tree.Assign(value, Lower(expression.Value)), assign, value);
+    }
+
+    public Tree VisitBinaryExpression(BinaryExpression expression)
+    {
+        var left = Lower(expression.Left);
+        var right = Lower(expression.Right);
+
+        return expression.Operator.Type switch
+        {
+            TokenType.BANG_EQUAL => Tree.Call(NotEqual, left, right),
+            TokenType.EQUAL_EQUAL => Tree.Call(Equal, left, right),
+            _ => Tree.Call(Helper(expression.Operator.Type.ToString()), left, right, Tree.Constant(expression.Operator)),
+        };
+    }
+
+    public Tree VisitCallExpression(CallExpression expression)
+    {
+        var arguments = Push(expression.Arguments);
+        var paren = Tree.Constant(expression.Paren);
+
+        if (expression.Callee is GetExpression get) return Invoke(get, arguments, paren);
+
+        return Tree.Call(Tree.Constant(interpreter), CallValue, paren, Lower(expression.Callee), arguments);
+    }
+
+    // Calls a method looked up on an instance without allocating the bound function. A field holding a
+    // callable is read before the arguments are evaluated, as the visitor does.
+    private Tree Invoke(GetExpression get, Tree arguments, Tree paren)
+    {
+        var name = Tree.Constant(get.Name);
+        var cache = Tree.Constant(get.Cache);
+        var loxInstance = Tree.Variable(typeof(LoxInstance), "instance");
+        var method = Tree.Variable(typeof(LoxFunction), "method");
+        var callee = Tree.Variable(typeof(LoxValue), "callee");
+        var start = Tree.Variable(typeof(int), "start");
+        var isMethod = Tree.NotEqual(method, Tree.Constant(null, typeof(LoxFunction)));
+
+        return Tree.Block(
+            typeof(LoxValue),
+            new[] { loxInstance, method, callee, start },
+            Tree.Assign(loxInstance, Tree.Call(PropertyOwner, Lower(get.LoxObject), name)),
+            Tree.Assign(method, Tree.Call(FindMethod, cache, loxInstance, name)),
+            Tree.IfThen(Tree.Not(isMethod), Tree.Assign(callee, Tree.Call(cache, GetCached, loxInstance, name))),
+            Tree.Assign(start, arguments),
+            Tree.Condition(
+                isMethod,
+                Tree.Call(Tree.Constant(interpreter), InvokeMethod, paren, method, loxInstance, start),
+                Tree.Call(Tree.Constant(interpreter), CallValue, paren, callee, start)));
+    }
+
+    // Evaluates to where the arguments start on the argument stack.
+    private Tree Push(List<Expression> arguments)
+    {
+        var stack = Tree.Constant(argumentStack);
+        var start = Tree.Variable(typeof(int), "start");
+
+        return Tree.Block(
+            typeof(int),
+            new[] { start },
+            arguments
+                .Select(argument => (Tree)Tree.Call(stack, PushArgument, Lower(argument)))
+                .Prepend(Tree.Assign(start, Tree.Property(stack, nameof(ArgumentStack.Count))))
+                .Append(start));
+    }
+
+    public Tree VisitGetExpression(GetExpression expression)
+    {
+        var name = Tree.Constant(expression.Name);
+        var loxInstance = Tree.Call(PropertyOwner, Lower(expression.LoxObject), name);
+
+        return Tree.Call(Tree.Constant(expression.Cache), GetCached, loxInstance, name);
+    }
+
+    public Tree VisitGroupingExpression(GroupingExpression expression) => Lower(expression.Expression);
+
+    public Tree VisitLiteralExpression(LiteralExpression expression) => Tree.Constant(LoxValue.FromLiteral(expression.Value));
+
+    public Tree VisitLogicalExpression(LogicalExpression expression)
+    {
+        var left = Tree.Variable(typeof(LoxValue), "left");
+        var truthy = Tree.Property(left, IsTruthy);
+        var right = Lower(expression.Right);
+
+        var result = expression.Operator.Type == TokenType.OR
+            ? Tree.Condition(truthy, left, right)
+            : Tree.Condition(truthy, right, left);
+
+        return Tree.Block(typeof(LoxValue), new[] { left }, Tree.Assign(left, Lower(expression.Left)), result);
+    }
+
+    // The object is checked before the value is evaluated, as the visitor does.
+    public Tree VisitSetExpression(SetExpression expression)
+    {
+        var name = Tree.Constant(expression.Name);
+        var loxInstance = Tree.Call(FieldOwner, Lower(expression.LoxObject), name);
+
+        return Tree.Call(SetField, Tree.Constant(expression.Cache), loxInstance, name, Lower(expression.Value));
+    }
+
+    public Tree VisitSuperExpression(SuperExpression expression)
+    {
+        // NOTE: the resolver always resolves super
+        var local = expression.Local.GetValueOrDefault();
+
+        return Tree.Call(Super, environment, Tree.Constant(local.distance), Tree.Constant(local.slot), Tree.Constant(expression.Method));
+    }
+
+    public Tree VisitThisExpression(ThisExpression expression) => LookUpVariable(expression.Keyword, expression);
+
+    public Tree VisitUnaryExpression(UnaryExpression expression) => expression.Operator.Type switch
+    {
+        TokenType.MINUS => Tree.Call(Negate, Lower(expression.Right), Tree.Constant(expression.Operator)),
+        TokenType.BANG => Tree.Call(Not, Lower(expression.Right)),
+        _ => throw new Exception($"unexpected token: '{expression.Operator}"), // impossible to hit
+    };
+
+    public Tree VisitVariableExpression(VariableExpression expression) => LookUpVariable(expression.Name, expression);
+    #endregion
+
+    #region Statements
+    public Tree VisitBlockStatement(BlockStatement statement)
+    {
+        var enclosing = environment;
+        environment = Tree.Variable(typeof(Environment), "environment");
+
+        try
+        {
+            var statements = statement.Statements.Select(Lower).Prepend(Tree.Assign(environment, Tree.New(NewEnvironment, enclosing)));
+
+            return Tree.Block(typeof(void), new[] { environment }, statements);
+        }
+        finally
+        {
+            environment = enclosing;
+        }
+    }
+
+    public Tree VisitClassStatement(ClassStatement statement)
+    {
+        var superClass = statement.SuperClass != null ? Lower(statement.SuperClass) : Tree.Constant(LoxValue.Nil);
+        var methods = statement.Methods.Select(Compile).ToArray();
+
+        return Tree.Call(DefineClass, environment, Tree.Constant(statement), superClass, Tree.Constant(methods));
+    }
+
+    public Tree VisitExpressionStatement(ExpressionStatement statement) => Lower(statement.Expression);
+
+    public Tree VisitFunctionStatement(FunctionStatement statement)
+    {
+        var function = Tree.New(NewFunction, Tree.Constant(statement), environment, Tree.Constant(false), Tree.Constant(Compile(statement)));
+
+        return Tree.Call(environment, Define, Tree.Constant(statement.Name.Symbol), Tree.New(NewCallableValue, function));
+    }
+
+    public Tree VisitIfStatement(IfStatement statement)
+    {
+        var condition = Tree.Property(Lower(statement.Condition), IsTruthy);
+
+        return statement.ElseBranch == null
+            ? Tree.IfThen(condition, Lower(statement.ThenBranch))
+            : Tree.IfThenElse(condition, Lower(statement.ThenBranch), Lower(statement.ElseBranch));
+    }
+
+    public Tree VisitPrintStatement(PrintStatement statement) =>
+        Tree.Call(Tree.Constant(interpreter), RaiseOut, Tree.Call(Lower(statement.Expression), Stringify));
+
+    public Tree VisitReturnStatement(ReturnStatement statement) =>
+        Tree.Return(returnLabel, statement.Value != null ? Lower(statement.Value) : Tree.Constant(LoxValue.Nil));
+
+    public Tree VisitVariableStatement(VariableStatement statement)
+    {
+        var value = statement.Initializer != null ? Lower(statement.Initializer) : Tree.Constant(LoxValue.Nil);
+
+        return Tree.Call(environment, Define, Tree.Constant(statement.Name.Symbol), value);
+    }
+
+    public Tree VisitWhileStatement(WhileStatement statement)
+    {
+        var end = Tree.Label("end");
+
+        var body = Tree.IfThenElse(Tree.Property(Lower(statement.Condition), IsTruthy), Lower(statement.Body), Tree.Break(end));
+
+        return Tree.Loop(body, end);
+    }
+    #endregion
+
+    #region Helper Methods
+    private Tree Lower(Expression expression) => expression.Accept(this);
+
+    private Tree Lower(Statement statement) => statement.Accept(this);
+
+    private Tree LookUpVariable(Token name, IResolvable expression)
+    {
+        if (expression.Local is { } local)
+        {
+            return Tree.Call(environment, GetAt, Tree.Constant(local.distance), Tree.Constant(local.slot));
+        }
+
+        return Tree.Call(Tree.Constant(globals), Get, Tree.Constant(name));
+    }
+
+    private static MethodInfo Helper(string name) =>
+        typeof(ExpressionTreeCompiler).GetMethod(name, BindingFlags.NonPublic | BindingFlags.Static)
+        ?? throw new Exception($"unexpected helper: '{name}'"); // impossible to hit
+
+    private static readonly MethodInfo GetAt = typeof(Environment).GetMethod(nameof(Environment.GetAt))!;
+    private static readonly MethodInfo AssignAt = typeof(Environment).GetMethod(nameof(Environment.AssignAt))!;
+    private static readonly MethodInfo Get = typeof(Environment).GetMethod(nameof(Environment.Get))!;
+    private static readonly MethodInfo Assign = typeof(Environment).GetMethod(nameof(Environment.Assign))!;
+    private static readonly MethodInfo Define = typeof(Environment).GetMethod(nameof(Environment.Define))!;
+    private static readonly ConstructorInfo NewEnvironment = typeof(Environment).GetConstructor(new[] { typeof(Environment) })!;
+    private static readonly ConstructorInfo NewFunction = typeof(LoxFunction).GetConstructors().Single();
+    private static readonly ConstructorInfo NewCallableValue = typeof(LoxValue).GetConstructor(BindingFlags.NonPublic | BindingFlags.Instance, new[] { typeof(LoxCallable) })!;
+    private static readonly MethodInfo RaiseOut = typeof(AstInterpreter).GetMethod(nameof(AstInterpreter.RaiseOut), BindingFlags.NonPublic | BindingFlags.Instance)!;
+    private static readonly MethodInfo Stringify = typeof(LoxValue).GetMethod(nameof(LoxValue.ToString))!;
+    private static readonly PropertyInfo IsTruthy = typeof(LoxValue).GetProperty(nameof(LoxValue.IsTruthy), BindingFlags.NonPublic | BindingFlags.Instance)!;
+    private static readonly MethodInfo Equal = Helper(nameof(EQUAL_EQUAL));
+    private static readonly MethodInfo NotEqual = Helper(nameof(BANG_EQUAL));
+    private static readonly MethodInfo Negate = Helper(nameof(NegateValue));
+    private static readonly MethodInfo Not = Helper(nameof(NotValue));
+    private static readonly MethodInfo CallValue = typeof(AstInterpreter).GetMethod(nameof(AstInterpreter.Call), BindingFlags.NonPublic | BindingFlags.Instance)!;
+    private static readonly MethodInfo GetCached = typeof(PropertyCache).GetMethod(nameof(PropertyCache.Get))!;
+    private static readonly MethodInfo PropertyOwner = Helper(nameof(CheckPropertyOwner));
+    private static readonly MethodInfo FieldOwner = Helper(nameof(CheckFieldOwner));
+    private static readonly MethodInfo FindMethod = Helper(nameof(FindCachedMethod));
+    private static readonly MethodInfo InvokeMethod = typeof(AstInterpreter).GetMethod(nameof(AstInterpreter.Invoke), BindingFlags.NonPublic | BindingFlags.Instance, new[] { typeof(Token), typeof(LoxFunction), typeof(LoxInstance), typeof(int) })!;
+    private static readonly MethodInfo PushArgument = typeof(ArgumentStack).GetMethod(nameof(ArgumentStack.Push))!;
+    private static readonly MethodInfo SetField = Helper(nameof(SetInstanceField));
+    private static readonly MethodInfo Super = Helper(nameof(BindSuperMethod));
+    private static readonly MethodInfo DefineClass = Helper(nameof(DefineLoxClass));
+
+    // Binary operators are looked up by the name of their token type.
+    private static LoxValue PLUS(LoxValue left, LoxValue right, Token operation) => AstInterpreter.Add(operation, left, right);
+
+    private static LoxValue MINUS(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l - r;
+    }
+
+    private static LoxValue SLASH(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l / r;
+    }
+
+    private static LoxValue STAR(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l * r;
+    }
+
+    private static LoxValue GREATER(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l > r;
+    }
+
+    private static LoxValue GREATER_EQUAL(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l >= r;
+    }
+
+    private static LoxValue LESS(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l < r;
+    }
+
+    private static LoxValue LESS_EQUAL(LoxValue left, LoxValue right, Token operation)
+    {
+        var (l, r) = AstInterpreter.CheckNumberOperands(operation, left, right);
+        return l <= r;
+    }
+
+    private static LoxValue EQUAL_EQUAL(LoxValue left, LoxValue right) => left.IsEqual(right);
+
+    private static LoxValue BANG_EQUAL(LoxValue left, LoxValue right) => !left.IsEqual(right);
+
+    private static LoxValue NegateValue(LoxValue right, Token operation) => -AstInterpreter.CheckNumberOperand(operation, right);
+
+    private static LoxValue NotValue(LoxValue right) => !right.IsTruthy;
+
+    private static LoxInstance CheckPropertyOwner(LoxValue loxObject, Token name)
+    {
+        if (loxObject.AsObject is LoxInstance loxInstance) return loxInstance;
+
+        throw new LoxRuntimeError(name, "Only instances have properties.");
+    }
+
+    private static LoxInstance CheckFieldOwner(LoxValue loxObject, Token name)
+    {
+        if (loxObject.AsObject is LoxInstance loxInstance) return loxInstance;
+
+        throw new LoxRuntimeError(name, "Only instances have fields.");
+    }
+
+    private static LoxFunction? FindCachedMethod(PropertyCache cache, LoxInstance loxInstance, Token name) =>
+        cache.TryGetMethod(loxInstance, name, out var method) ? method : null;
+
+    private static LoxValue SetInstanceField(PropertyCache cache, LoxInstance loxInstance, Token name, LoxValue value)
+    {
+        cache.Set(loxInstance, name, value);
+        return value;
+    }
+
+    private static LoxValue BindSuperMethod(Environment environment, int distance, int slot, Token method)
+    {
+        var superLoxClass = (LoxClass)environment.GetAt(distance, slot).AsObject!;
+        var loxInstance = (LoxInstance)environment.GetAt(distance - 1, LoxInstance.THIS_SLOT).AsObject!;
+
+        if (superLoxClass.TryGetMethod(method.Symbol, out var function)) return new LoxValue(function.Bind(loxInstance));
+
+        throw new LoxRuntimeError(method, $"Undefined property '{method.Lexeme}'.");
+    }
+
+    private static void DefineLoxClass(Environment environment, ClassStatement statement, LoxValue superClass, CompiledStatement[] bodies)
+    {
+        LoxClass? superLoxClass = null;
+        var enclosing = environment;
+
+        if (statement.SuperClass != null)
+        {
+            if (superClass.AsObject is not LoxClass loxClass)
+            {
+                throw new LoxRuntimeError(statement.SuperClass.Name, "Super class must be a class.");
+            }
+
+            superLoxClass = loxClass;
+            environment = new Environment(environment);
+            environment.Define(LoxClass.SUPER, new LoxValue(superLoxClass));
+        }
+
+        var methods = new Dictionary<Symbol, LoxFunction>();
+        for (var i = 0; i < statement.Methods.Count; i++)
+        {
+            var method = statement.Methods[i];
+            methods[method.Name.Symbol] = new LoxFunction(method, environment, LoxClass.IsInitializer(method.Name.Symbol), bodies[i]);
+        }
+
+        enclosing.Define(statement.Name.Symbol, new LoxValue(new LoxClass(statement.Name.Lexeme, superLoxClass, methods)));
+    }
+    #endregion
+}
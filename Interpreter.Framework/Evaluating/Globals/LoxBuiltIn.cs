@@ -6,7 +6,7 @@ internal abstract class LoxBuiltIn : LoxCallable
 
 internal class Clock : LoxBuiltIn
 {
-    public override object? Call(AstInterpreter interpreter, IEnumerable<object?> arguments)
+    public override LoxValue Call(AstInterpreter interpreter, ReadOnlySpan<LoxValue> arguments)
     {
         return DateTime.UtcNow.Subtract(new DateTime(1970, 1, 1)).TotalSeconds;
     }
@@ -16,10 +16,10 @@ internal class Clock : LoxBuiltIn
 
 internal class Reset : LoxBuiltIn
 {
-    public override object? Call(AstInterpreter interpreter, IEnumerable<object?> arguments)
+    public override LoxValue Call(AstInterpreter interpreter, ReadOnlySpan<LoxValue> arguments)
     {
         interpreter.Reset();
 
-        return null;
+        return LoxValue.Nil;
     }
 }
@@ -4,12 +4,12 @@ interface ILoxCallable
 {
     int Arity { get; }
 
-    object? Call(AstInterpreter interpreter, IEnumerable<object?> arguments);
+    LoxValue Call(AstInterpreter interpreter, ReadOnlySpan<LoxValue> arguments);
 }
 
 abstract class LoxCallable : ILoxCallable
 {
     public virtual int Arity => 0;
 
-    public abstract object? Call(AstInterpreter interpreter, IEnumerable<object?> arguments);
+    public abstract LoxValue Call(AstInterpreter interpreter, ReadOnlySpan<LoxValue> arguments);
 }
@@ -1,24 +1,31 @@
-﻿using System.Diagnostics.CodeAnalysis;
+﻿using Interpreter.Framework.Scanning;
+using System.Diagnostics.CodeAnalysis;
 
 namespace Interpreter.Framework.Evaluating;
 internal class LoxClass : LoxCallable
 {
     public string Name { get; init; }
     private readonly LoxClass? superClass;
-    private readonly Dictionary<string, LoxFunction> methods;
-    private const string INIT = "init";
-    public const string SUPER = "super";
+    private readonly Dictionary<Symbol, LoxFunction> methods;
+    private static readonly Symbol INIT = Symbol.For("init");
+    public static readonly Symbol SUPER = Symbol.For("super");
 
-    public LoxClass(string name, LoxClass? superClass, Dictionary<string, LoxFunction> methods)
+    // The shape of instances that have no fields yet.
+    public readonly Shape Shape = new();
+
+    // The most fields any instance has had, so new instances are created with room for them all.
+    public int FieldCapacity = 0;
+
+    public LoxClass(string name, LoxClass? superClass, Dictionary<Symbol, LoxFunction> methods)
     {
         Name = name;
         this.superClass = superClass;
         this.methods = methods;
     }
 
-    public static bool IsInitializer(string name) => name == INIT;
+    public static bool IsInitializer(Symbol name) => name == INIT;
 
-    public bool TryGetMethod(string name, [MaybeNullWhen(false)] out LoxFunction function)
+    public bool TryGetMethod(Symbol name, [MaybeNullWhen(false)] out LoxFunction function)
     {
         if (methods.TryGetValue(name, out function)) return true;
 
@@ -28,14 +35,14 @@ internal class LoxClass : LoxCallable
         return false;
     }
 
-    public override object? Call(AstInterpreter interpreter, IEnumerable<object?> arguments)
+    public override LoxValue Call(AstInterpreter interpreter, ReadOnlySpan<LoxValue> arguments)
     {
         var instance = new LoxInstance(this);
         if (TryGetMethod(INIT, out var initializer))
         {
-            initializer.Bind(instance).Call(interpreter, arguments);
+            initializer.Invoke(interpreter, instance, arguments);
         }
-        return instance;
+        return new LoxValue(instance);
     }
 
     public override int Arity
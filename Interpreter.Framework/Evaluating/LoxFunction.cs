@@ -7,46 +7,45 @@ internal class LoxFunction : LoxCallable
     private readonly Environment closure;
     private readonly bool IsInitializer;
 
-    public LoxFunction(FunctionStatement declaration, Environment closure, bool isInitializer)
+    // Set when a compiling backend compiled the function instead of leaving it to the visitor.
+    private readonly CompiledStatement? body;
+
+    public LoxFunction(FunctionStatement declaration, Environment closure, bool isInitializer, CompiledStatement? body = null)
     {
         this.declaration = declaration;
         this.closure = closure;
         IsInitializer = isInitializer;
+        this.body = body;
     }
 
-    public LoxFunction Bind(LoxInstance loxInstance)
-    {
-        var environment = new Environment(closure);
-        environment.Define(LoxInstance.THIS, loxInstance);
-        return new LoxFunction(declaration, environment, IsInitializer);
-    }
+    public LoxFunction Bind(LoxInstance loxInstance) => new(declaration, BindThis(loxInstance), IsInitializer, body);
 
     public override int Arity => declaration.Parameters.Count;
 
-    public override object? Call(AstInterpreter interpreter, IEnumerable<object?> arguments)
+    public override LoxValue Call(AstInterpreter interpreter, ReadOnlySpan<LoxValue> arguments) =>
+        Call(interpreter, closure, arguments);
+
+    // Calls the method on loxInstance the way Bind(loxInstance).Call does, without allocating the bound function.
+    public LoxValue Invoke(AstInterpreter interpreter, LoxInstance loxInstance, ReadOnlySpan<LoxValue> arguments) =>
+        Call(interpreter, BindThis(loxInstance), arguments);
+
+    private Environment BindThis(LoxInstance loxInstance)
     {
         var environment = new Environment(closure);
-        var args = arguments.ToList();
-
-        for (var i = 0; i < declaration.Parameters.Count; i++)
-        {
-            environment.Define(declaration.Parameters[i].Lexeme, args[i]);
-        }
+        environment.Define(LoxInstance.THIS, new LoxValue(loxInstance));
+        return environment;
+    }
 
-        try
-        {
-            interpreter.ExecuteBlock(declaration.Body, environment);
-        }
-        catch (Return returnValue)
-        {
-            if (IsInitializer) return closure.GetAt(0, LoxInstance.THIS);
+    private LoxValue Call(AstInterpreter interpreter, Environment closure, ReadOnlySpan<LoxValue> arguments)
+    {
+        // The parameters are the first locals the body declares.
+        var environment = new Environment(closure, arguments);
 
-            return returnValue.Value;
-        }
+        var value = body != null ? body(environment) : interpreter.ExecuteBlock(declaration.Body, environment);
 
-        if (IsInitializer) return closure.GetAt(0, LoxInstance.THIS);
+        if (IsInitializer) return closure.GetAt(0, LoxInstance.THIS_SLOT);
 
-        return null;
+        return Completion.IsNormal(value) ? LoxValue.Nil : value;
     }
 
     public override string ToString() => $"<function {declaration.Name.Lexeme}>";
@@ -3,25 +3,57 @@
 namespace Interpreter.Framework.Evaluating;
 internal class LoxInstance
 {
-    private readonly LoxClass loxClass;
-    private readonly Dictionary<string, object?> fields = new();
-    public const string THIS = "this";
+    public readonly LoxClass LoxClass;
+    public static readonly Symbol THIS = Symbol.For("this");
+    public const int THIS_SLOT = 0;
+
+    // Fields are stored in the slots their names have in Shape.
+    public Shape Shape { get; private set; }
+    private LoxValue[] fields;
 
     public LoxInstance(LoxClass loxClass)
     {
-        this.loxClass = loxClass;
+        LoxClass = loxClass;
+        Shape = loxClass.Shape;
+        fields = loxClass.FieldCapacity > 0 ? new LoxValue[loxClass.FieldCapacity] : Array.Empty<LoxValue>();
     }
 
-    public object? Get(Token name)
+    public LoxValue Get(Token name)
     {
-        if (fields.TryGetValue(name.Lexeme, out var property)) return property;
+        if (Shape.TryGetIndex(name.Symbol, out var index)) return fields[index];
 
-        if (loxClass.TryGetMethod(name.Lexeme, out var method)) return method.Bind(this);
+        if (LoxClass.TryGetMethod(name.Symbol, out var method)) return new LoxValue(method.Bind(this));
 
         throw new LoxRuntimeError(name, $"Undefined property '{name.Lexeme}'.");
     }
 
-    public void Set(Token name, object? value) => fields[name.Lexeme] = value;
+    public void Set(Token name, LoxValue value)
+    {
+        if (Shape.TryGetIndex(name.Symbol, out var index))
+        {
+            fields[index] = value;
+            return;
+        }
+
+        SetField(Shape.Add(name.Symbol), Shape.Count, value);
+    }
+
+    public LoxValue GetField(int index) => fields[index];
+
+    // Stores value in the slot at index of shape, which is either the current shape or the one adding that slot.
+    public void SetField(Shape shape, int index, LoxValue value)
+    {
+        if (index == fields.Length)
+        {
+            Array.Resize(ref fields, Math.Max(4, fields.Length * 2));
+
+            // Later instances of the class start out with room for as many fields as this one needed.
+            LoxClass.FieldCapacity = Math.Max(LoxClass.FieldCapacity, fields.Length);
+        }
+
+        Shape = shape;
+        fields[index] = value;
+    }
 
-    public override string ToString() => $"{loxClass.Name} instance";
+    public override string ToString() => $"{LoxClass.Name} instance";
 }
@@ -0,0 +1,87 @@
+﻿namespace Interpreter.Framework.Evaluating;
+
+// A Lox value that holds numbers and booleans without boxing them. Those keep their payload in number and
+// a shared tag object in reference; strings, callables and instances are the reference itself; nil is default.
+public readonly struct LoxValue
+{
+    private static readonly object NumberTag = new();
+    private static readonly object BooleanTag = new();
+
+    private readonly double number;
+    private readonly object? reference;
+
+    private LoxValue(double number, object? reference)
+    {
+        this.number = number;
+        this.reference = reference;
+    }
+
+    internal LoxValue(LoxCallable callable) : this(0, callable) { }
+
+    internal LoxValue(LoxInstance instance) : this(0, instance) { }
+
+    public static readonly LoxValue Nil = default;
+    public static readonly LoxValue True = new(1, BooleanTag);
+    public static readonly LoxValue False = new(0, BooleanTag);
+
+    public static implicit operator LoxValue(double value) => new(value, NumberTag);
+    public static implicit operator LoxValue(bool value) => value ? True : False;
+    public static implicit operator LoxValue(string value) => new(0, value);
+
+    // Values the scanner put in literal tokens.
+    internal static LoxValue FromLiteral(object? literal) => literal switch
+    {
+        null => Nil,
+        double dbl => dbl,
+        bool boolean => boolean,
+        _ => new(0, literal),
+    };
+
+    // Not a Lox value, for markers such as Completion.Normal that share a slot with Lox values.
+    internal static LoxValue Sentinel() => new(0, new object());
+
+    internal bool IsNumber => reference == NumberTag;
+
+    internal double AsNumber => number;
+
+    internal bool IsTruthy => reference != null && (reference != BooleanTag || number != 0);
+
+    // The string, callable or instance this holds, or null for nil, numbers and booleans.
+    internal object? AsObject => reference == NumberTag || reference == BooleanTag ? null : reference;
+
+    internal bool TryGetNumber(out double value)
+    {
+        value = number;
+        return reference == NumberTag;
+    }
+
+    internal bool TryGetString(out string value)
+    {
+        value = reference as string ?? string.Empty;
+        return reference is string;
+    }
+
+    // Lox equality. Numbers compare with double.Equals, so NaN is equal to itself as it was for boxed doubles.
+    internal bool IsEqual(LoxValue other)
+    {
+        if (reference == NumberTag || reference == BooleanTag)
+        {
+            return reference == other.reference && number.Equals(other.number);
+        }
+
+        if (reference == null) return other.reference == null;
+
+        return reference.Equals(other.reference);
+    }
+
+    internal bool IsIdentical(LoxValue other) => reference == other.reference && number.Equals(other.number);
+
+    public override string ToString()
+    {
+        if (reference == NumberTag) return number.ToString();
+
+        if (reference == BooleanTag) return number != 0 ? "true" : "false";
+
+        return reference?.ToString() ?? "nil";
+    }
+}
@@ -0,0 +1,71 @@
+﻿using Interpreter.Framework.Scanning;
+using System.Diagnostics.CodeAnalysis;
+
+namespace Interpreter.Framework.Evaluating;
+
+// An inline cache for one property access in the source. It remembers what the property resolved to for
+// the shape of the last instance seen there, so instances with that shape skip the name lookups.
+internal class PropertyCache
+{
+    private Shape? shape;
+
+    // The field's slot, or -1 when the property is a method or undefined.
+    private int index = -1;
+    private LoxFunction? method;
+
+    // The shape an instance has after a set here stores the field.
+    private Shape? next;
+
+    public bool TryGetMethod(LoxInstance loxInstance, Token name, [NotNullWhen(true)] out LoxFunction? method)
+    {
+        if (loxInstance.Shape != shape) LookUp(loxInstance, name);
+
+        method = this.method;
+        return method != null;
+    }
+
+    public LoxValue Get(LoxInstance loxInstance, Token name)
+    {
+        if (loxInstance.Shape != shape) LookUp(loxInstance, name);
+
+        if (index >= 0) return loxInstance.GetField(index);
+
+        if (method != null) return new LoxValue(method.Bind(loxInstance));
+
+        throw new LoxRuntimeError(name, $"Undefined property '{name.Lexeme}'.");
+    }
+
+    public void Set(LoxInstance loxInstance, Token name, LoxValue value)
+    {
+        if (loxInstance.Shape != shape)
+        {
+            shape = loxInstance.Shape;
+            method = null;
+
+            if (shape.TryGetIndex(name.Symbol, out index))
+            {
+                next = shape;
+            }
+            else
+            {
+                index = shape.Count;
+                next = shape.Add(name.Symbol);
+            }
+        }
+
+        loxInstance.SetField(next!, index, value);
+    }
+
+    // Fields shadow methods, as they do in LoxInstance.Get.
+    private void LookUp(LoxInstance loxInstance, Token name)
+    {
+        shape = loxInstance.Shape;
+        method = null;
+
+        if (!shape.TryGetIndex(name.Symbol, out index))
+        {
+            index = -1;
+            loxInstance.LoxClass.TryGetMethod(name.Symbol, out method);
+        }
+    }
+}
@@ -0,0 +1,31 @@
+﻿using Interpreter.Framework.Scanning;
+
+namespace Interpreter.Framework.Evaluating;
+
+// The field layout shared by every instance of a class that added the same fields in the same order.
+// Each class has its own root shape, so a shape also identifies the class its instances belong to.
+internal class Shape
+{
+    private readonly Dictionary<Symbol, int> indices;
+    private readonly Dictionary<Symbol, Shape> transitions = new();
+
+    public Shape() { indices = new(); }
+
+    private Shape(Dictionary<Symbol, int> indices) { this.indices = indices; }
+
+    public int Count => indices.Count;
+
+    public bool TryGetIndex(Symbol name, out int index) => indices.TryGetValue(name, out index);
+
+    // The shape an instance moves to when it adds the field name, which goes in slot Count.
+    public Shape Add(Symbol name)
+    {
+        if (!transitions.TryGetValue(name, out var shape))
+        {
+            shape = new Shape(new Dictionary<Symbol, int>(indices) { [name] = indices.Count });
+            transitions[name] = shape;
+        }
+
+        return shape;
+    }
+}
@@ -3,32 +3,46 @@ using Interpreter.Framework.Evaluating;
 using Interpreter.Framework.Parsing;
 using Interpreter.Framework.Scanning;
 using Interpreter.Framework.StaticAnalysis;
+using System.Diagnostics.CodeAnalysis;
 using static Interpreter.Framework.InterpreterErrorEventArgs;
 
 namespace Interpreter.Framework;
 
 public static class Interpreter
 {
-    private static readonly AstInterpreter interpreter = new();
+    private static AstInterpreter? interpreter;
     private static readonly Printer printer = new();
-    private static bool initialized = false;
 
+    // Read by the first call to Run.
+    public static Backend Backend { get; set; } = Backend.Visitor;
+
+    [MemberNotNull(nameof(interpreter))]
     private static void Initialize()
     {
+        interpreter = new AstInterpreter(Backend);
         interpreter.Out += (_, e) => RaiseOut(e.Content);
-        initialized = true;
     }
 
     public static void Run(string? source)
     {
-        if (!initialized) Initialize();
+        if (interpreter == null) Initialize();
 
         if (string.IsNullOrEmpty(source))
         {
             return;
         }
 
-        var (tokens, scanErrors) = Scanner.ScanTokens(source);
+        // Only listing the tokens for the debugger needs them all at once.
+        if (Debug != null)
+        {
+            RaiseDebug("Tokens:");
+            foreach (var token in Scanner.ScanTokens(source).tokens)
+            {
+                RaiseDebug($"- {token}");
+            }
+        }
+
+        var (statements, scanErrors, parseErrors) = Parser.Parse(source, interpreter.Names);
 
         if (scanErrors.Any())
         {
@@ -39,14 +53,6 @@ public static class Interpreter
             return;
         }
 
-        RaiseDebug("Tokens:");
-        foreach (var token in tokens)
-        {
-            RaiseDebug($"- {token}");
-        }
-
-        var (statements, parseErrors) = Parser.Parse(tokens);
-
         if (parseErrors.Any())
         {
             foreach (var error in parseErrors)
@@ -56,10 +62,13 @@ public static class Interpreter
             return;
         }
 
-        RaiseDebug($"AST:)");
-        RaiseDebug(printer.Print(statements));
+        if (Debug != null)
+        {
+            RaiseDebug($"AST:)");
+            RaiseDebug(printer.Print(statements));
+        }
 
-        var resolveErrors = Resolver.Resolve(interpreter, statements);
+        var resolveErrors = Resolver.Resolve(statements);
 
         if (resolveErrors.Any())
         {
@@ -6,4 +6,17 @@ public static class Parser
 {
     public static (IEnumerable<Statement>, IEnumerable<ParseError> parseErrors) Parse(IEnumerable<Token> tokens) =>
         new TokenParser(tokens).Parse();
+
+    public static (IEnumerable<Statement>, IEnumerable<ScanError> scanErrors, IEnumerable<ParseError> parseErrors) Parse(string source) =>
+        Parse(source, new NameTable());
+
+    // Scans source as the parser reads it rather than building the token list first. Parse errors that
+    // follow a scan error may only be a consequence of it. Names are interned in the given table.
+    public static (IEnumerable<Statement>, IEnumerable<ScanError> scanErrors, IEnumerable<ParseError> parseErrors) Parse(string source, NameTable names)
+    {
+        var scanner = new SourceScanner(source, names);
+        var (statements, parseErrors) = new TokenParser(scanner.NextToken).Parse();
+
+        return (statements, scanner.Errors, parseErrors);
+    }
 }
\ No newline at end of file
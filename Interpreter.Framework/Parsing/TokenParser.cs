@@ -4,16 +4,24 @@ using Interpreter.Framework.Scanning;
 namespace Interpreter.Framework.Parsing;
 internal class TokenParser
 {
-    private readonly Token[] tokens;
-    private int current = 0;
+    private readonly Func<Token> nextToken;
+    private Token current;
+    private Token previous;
 
     private const int ARG_LIMIT = 255;
 
     private List<ParseError> Errors { get; } = new();
 
-    public TokenParser(IEnumerable<Token> tokens)
+    // tokens has to end with EOF, which the parser never reads past.
+    public TokenParser(IEnumerable<Token> tokens) : this(tokens.GetEnumerator()) { }
+
+    private TokenParser(IEnumerator<Token> tokens) : this(() => tokens.MoveNext() ? tokens.Current : new Token(TokenType.EOF, Symbol.For(string.Empty), 0)) { }
+
+    // The parser only looks one token ahead, so it can pull tokens from the scanner as it goes.
+    public TokenParser(Func<Token> nextToken)
     {
-        this.tokens = tokens.ToArray();
+        this.nextToken = nextToken;
+        current = nextToken();
     }
 
     #region Grammar
@@ -482,6 +490,15 @@ internal class TokenParser
     #endregion
 
     #region Helper Methods
+    // Spares the common single type match the params array.
+    private bool Match(TokenType tokenType)
+    {
+        if (!Check(tokenType)) return false;
+
+        Advance();
+        return true;
+    }
+
     private bool Match(params TokenType[] tokenTypes)
     {
         foreach (var tokenType in tokenTypes)
@@ -505,16 +522,20 @@ internal class TokenParser
 
     private Token Advance()
     {
-        if (!IsAtEnd()) current++;
+        if (!IsAtEnd())
+        {
+            previous = current;
+            current = nextToken();
+        }
 
         return Previous();
     }
 
-    private bool IsAtEnd() => tokens[current].Type == TokenType.EOF;
+    private bool IsAtEnd() => current.Type == TokenType.EOF;
 
-    private Token Peek() => tokens[current];
+    private Token Peek() => current;
 
-    private Token Previous() => tokens[current - 1];
+    private Token Previous() => previous;
 
     private Token Consume(TokenType expected, string errorMessage)
     {
@@ -0,0 +1,120 @@
+﻿namespace Interpreter.Framework.Scanning;
+
+// Interns names as Symbols, so every occurrence of a name shares one and the scanner only copies text out
+// of the source the first time it sees it. Each interpreter owns a table, and the scanners feeding it
+// share that table, so a global defined in one run is found by the next. Keywords and the names the
+// runtime refers to itself are predefined in a table every other table falls back on, which keeps those
+// Symbols the same everywhere and lets one lookup both intern an identifier and tell whether it is a
+// keyword.
+public sealed class NameTable
+{
+    private class Entry
+    {
+        public readonly Symbol Symbol;
+        public readonly TokenType Type;
+        public readonly int Hash;
+        public readonly Entry? Next;
+
+        public Entry(Symbol symbol, TokenType type, int hash, Entry? next)
+        {
+            Symbol = symbol;
+            Type = type;
+            Hash = hash;
+            Next = next;
+        }
+    }
+
+    // Only written while the type initializes, so tables on different threads can read it without locking.
+    private static readonly NameTable predefined = new(null);
+
+    private readonly NameTable? parent;
+    private Entry?[] buckets = new Entry?[256];
+    private int count = 0;
+
+    // Ids carry on from the predefined table's, so a Symbol's id is unique among those it can meet.
+    private readonly int firstId;
+
+    static NameTable()
+    {
+        predefined.Add("and", TokenType.AND);
+        predefined.Add("class", TokenType.CLASS);
+        predefined.Add("else", TokenType.ELSE);
+        predefined.Add("false", TokenType.FALSE);
+        predefined.Add("for", TokenType.FOR);
+        predefined.Add("fun", TokenType.FUN);
+        predefined.Add("if", TokenType.IF);
+        predefined.Add("nil", TokenType.NIL);
+        predefined.Add("or", TokenType.OR);
+        predefined.Add("print", TokenType.PRINT);
+        predefined.Add("return", TokenType.RETURN);
+        predefined.Add("super", TokenType.SUPER);
+        predefined.Add("this", TokenType.THIS);
+        predefined.Add("true", TokenType.TRUE);
+        predefined.Add("var", TokenType.VAR);
+        predefined.Add("while", TokenType.WHILE);
+
+        predefined.Add("init", TokenType.IDENTIFIER);
+        predefined.Add("clock", TokenType.IDENTIFIER);
+        predefined.Add("reset", TokenType.IDENTIFIER);
+    }
+
+    public NameTable() : this(predefined) { }
+
+    private NameTable(NameTable? parent)
+    {
+        this.parent = parent;
+        firstId = parent?.firstId + parent?.count ?? 0;
+    }
+
+    internal static Symbol? Predefined(ReadOnlySpan<char> text) => predefined.Find(text, string.GetHashCode(text))?.Symbol;
+
+    // type is the keyword's token type, or IDENTIFIER for any other text.
+    internal Symbol Intern(ReadOnlySpan<char> text, out TokenType type)
+    {
+        var hash = string.GetHashCode(text);
+        var entry = parent?.Find(text, hash) ?? Find(text, hash) ?? Add(text.ToString(), TokenType.IDENTIFIER, hash);
+
+        type = entry.Type;
+        return entry.Symbol;
+    }
+
+    private Entry? Find(ReadOnlySpan<char> text, int hash)
+    {
+        for (var entry = buckets[hash & (buckets.Length - 1)]; entry != null; entry = entry.Next)
+        {
+            if (entry.Hash == hash && text.SequenceEqual(entry.Symbol.Name)) return entry;
+        }
+
+        return null;
+    }
+
+    private void Add(string text, TokenType type) => Add(text, type, string.GetHashCode(text));
+
+    private Entry Add(string text, TokenType type, int hash)
+    {
+        if (count == buckets.Length) Grow();
+
+        var symbol = new Symbol(text, firstId + count);
+        var bucket = hash & (buckets.Length - 1);
+        var entry = new Entry(symbol, type, hash, buckets[bucket]);
+        buckets[bucket] = entry;
+        count++;
+
+        return entry;
+    }
+
+    private void Grow()
+    {
+        var entries = buckets;
+        buckets = new Entry?[entries.Length * 2];
+
+        foreach (var first in entries)
+        {
+            for (var entry = first; entry != null; entry = entry.Next)
+            {
+                var bucket = entry.Hash & (buckets.Length - 1);
+                buckets[bucket] = new Entry(entry.Symbol, entry.Type, entry.Hash, buckets[bucket]);
+            }
+        }
+    }
+}
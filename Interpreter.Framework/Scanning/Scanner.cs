@@ -3,5 +3,9 @@
 public static class Scanner
 {
     public static (IEnumerable<Token> tokens, IEnumerable<ScanError> scanErrors) ScanTokens(string source) =>
-        new SourceScanner(source).Scan();
+        ScanTokens(source, new NameTable());
+
+    // Names are interned in the given table, so they match the Symbols of earlier sources scanned with it.
+    public static (IEnumerable<Token> tokens, IEnumerable<ScanError> scanErrors) ScanTokens(string source, NameTable names) =>
+        new SourceScanner(source, names).Scan();
 }
@@ -1,47 +1,80 @@
 namespace Interpreter.Framework.Scanning;
 
+// Scans one token at a time as the parser asks for them. Lexemes are read as spans of the source, and
+// names are interned, so an identifier only allocates the first time its text appears.
 class SourceScanner
 {
     private readonly string source;
+    private readonly NameTable names;
     private int start = 0;
     private int current = 0;
     private int line = 1;
 
-    private static readonly Dictionary<string, TokenType> keyWords = new()
+    // The token the last call to ScanToken produced, if any.
+    private Token? token;
+
+    // Operators and punctuation always have the same text, so their Symbols are made once.
+    private static readonly Symbol?[] operators = Operators(new()
+    {
+        { TokenType.LEFT_PAREN, "(" },
+        { TokenType.RIGHT_PAREN, ")" },
+        { TokenType.LEFT_BRACE, "{" },
+        { TokenType.RIGHT_BRACE, "}" },
+        { TokenType.COMMA, "," },
+        { TokenType.DOT, "." },
+        { TokenType.MINUS, "-" },
+        { TokenType.PLUS, "+" },
+        { TokenType.COLON, ":" },
+        { TokenType.SEMICOLON, ";" },
+        { TokenType.SLASH, "/" },
+        { TokenType.STAR, "*" },
+        { TokenType.BANG, "!" },
+        { TokenType.BANG_EQUAL, "!=" },
+        { TokenType.EQUAL, "=" },
+        { TokenType.EQUAL_EQUAL, "==" },
+        { TokenType.GREATER, ">" },
+        { TokenType.GREATER_EQUAL, ">=" },
+        { TokenType.LESS, "<" },
+        { TokenType.LESS_EQUAL, "<=" },
+    });
+
+    private static readonly Symbol EndOfFile = Symbol.For(string.Empty);
+
+    public List<ScanError> Errors { get; } = new();
+
+    public SourceScanner(string source, NameTable names)
     {
-        { "and",    TokenType.AND },
-        { "class",  TokenType.CLASS },
-        { "else",   TokenType.ELSE },
-        { "false",  TokenType.FALSE },
-        { "for",    TokenType.FOR },
-        { "fun",    TokenType.FUN },
-        { "if",     TokenType.IF },
-        { "nil",    TokenType.NIL },
-        { "or",     TokenType.OR },
-        { "print",  TokenType.PRINT },
-        { "return", TokenType.RETURN },
-        { "super",  TokenType.SUPER },
-        { "this",   TokenType.THIS },
-        { "true",   TokenType.TRUE },
-        { "var",    TokenType.VAR },
-        { "while",  TokenType.WHILE },
-    };
-
-    private List<Token> Tokens { get; } = new();
-    private List<ScanError> Errors { get; } = new();
-
-    public SourceScanner(string source) { this.source = source; }
+        this.source = source;
+        this.names = names;
+    }
 
     public (IEnumerable<Token> tokens, IEnumerable<ScanError> scanErrors) Scan()
+    {
+        var tokens = new List<Token>();
+
+        do
+        {
+            tokens.Add(NextToken());
+        } while (tokens[^1].Type != TokenType.EOF);
+
+        return (tokens, Errors);
+    }
+
+    // Returns EOF once the source is used up, however many times it is called.
+    public Token NextToken()
     {
         while (!IsAtEnd())
         {
             ScanToken();
-        }
 
-        Tokens.Add(new Token(TokenType.EOF, string.Empty, line, null));
+            if (token is Token next)
+            {
+                token = null;
+                return next;
+            }
+        }
 
-        return (Tokens, Errors);
+        return new Token(TokenType.EOF, EndOfFile, line, null);
     }
 
     #region Tokens
@@ -142,24 +175,16 @@ class SourceScanner
             ConsumeNumber();
         }
 
-        AddToken(TokenType.NUMBER, double.Parse(source[start..current]));
+        AddToken(TokenType.NUMBER, double.Parse(Lexeme()));
     }
 
     private void Identifier()
     {
         while (IsAlphaNumeric(Peek())) Advance();
 
-        var text = source[start..current];
-
-        if (keyWords.TryGetValue(text, out var keyWordTokenType))
-        {
-            AddToken(keyWordTokenType);
-        }
-        else
-        {
-            AddToken(TokenType.IDENTIFIER);
-        }
+        var symbol = names.Intern(Lexeme(), out var type);
 
+        token = new Token(type, symbol, line, null);
     }
     #endregion
 
@@ -168,10 +193,26 @@ class SourceScanner
 
     private char Advance() => source[current++];
 
+    private ReadOnlySpan<char> Lexeme() => source.AsSpan()[start..current];
+
+    // Literals are not interned: their text is copied once for the token and never looked up by name.
     private void AddToken(TokenType type, object? literal = null)
     {
-        var text = source[start..current];
-        Tokens.Add(new Token(type, text, line, literal));
+        var symbol = operators[(int)type] ?? new Symbol(Lexeme().ToString());
+
+        token = new Token(type, symbol, line, literal);
+    }
+
+    private static Symbol?[] Operators(Dictionary<TokenType, string> texts)
+    {
+        var symbols = new Symbol?[Enum.GetValues<TokenType>().Length];
+
+        foreach (var (type, text) in texts)
+        {
+            symbols[(int)type] = Symbol.For(text);
+        }
+
+        return symbols;
     }
 
     private bool Match(char expected)
@@ -0,0 +1,25 @@
+﻿namespace Interpreter.Framework.Scanning;
+
+// An interned name. A NameTable makes one Symbol per distinct text, so symbols compare by reference and
+// hash by a number assigned on creation, never by their characters. Literals and operators get Symbols
+// outside any table, since nothing looks them up by name.
+public sealed class Symbol
+{
+    public readonly string Name;
+    private readonly int id;
+
+    internal Symbol(string name, int id)
+    {
+        Name = name;
+        this.id = id;
+    }
+
+    internal Symbol(string name) : this(name, name.GetHashCode()) { }
+
+    // The predefined Symbol for a keyword or a name the runtime uses, or else a new one no table shares.
+    public static Symbol For(string name) => NameTable.Predefined(name) ?? new Symbol(name);
+
+    public override int GetHashCode() => id;
+
+    public override string ToString() => Name;
+}
@@ -1,6 +1,8 @@
 ﻿namespace Interpreter.Framework.Scanning;
 
-public readonly record struct Token(TokenType Type, string Lexeme, int Line, object? Literal = null)
+public readonly record struct Token(TokenType Type, Symbol Symbol, int Line, object? Literal = null)
 {
+    public string Lexeme => Symbol.Name;
+
     public override string ToString() => $"{Line} {Type} {Lexeme} {Literal}";
 }
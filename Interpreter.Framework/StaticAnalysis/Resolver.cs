@@ -5,19 +5,20 @@ using Interpreter.Framework.Scanning;
 namespace Interpreter.Framework.StaticAnalysis;
 public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?>
 {
-    private readonly Scope scope;
+    private readonly Scope scope = new();
     private readonly List<ScopeError> errors = new();
 
-    private Resolver(AstInterpreter interpreter)
-    {
-        scope = new Scope(interpreter);
-    }
+    private Resolver() { }
 
-    public static IEnumerable<ScopeError> Resolve(AstInterpreter interpreter, IEnumerable<Statement> statements)
+    // Records where each local variable lives on the expressions that name it.
+    public static IEnumerable<ScopeError> Resolve(IEnumerable<Statement> statements)
     {
-        var resolver = new Resolver(interpreter);
+        var resolver = new Resolver();
 
-        resolver.Resolve(statements);
+        foreach (var statement in statements)
+        {
+            resolver.Resolve(statement);
+        }
 
         return resolver.errors;
     }
@@ -114,8 +115,8 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
 
     public object? VisitVariableExpression(VariableExpression expression)
     {
-        if (scope.IsDeclared(expression.Name.Lexeme) &&
-            !scope.IsDefined(expression.Name.Lexeme))
+        if (scope.IsDeclared(expression.Name.Symbol) &&
+            !scope.IsDefined(expression.Name.Symbol))
         {
             errors.Add(new ScopeError(expression.Name, "Can't read local variable in its own initializer."));
         }
@@ -142,7 +143,7 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
 
         if (statement.SuperClass!= null)
         {
-            if (statement.Name.Lexeme == statement.SuperClass.Name.Lexeme)
+            if (statement.Name.Symbol == statement.SuperClass.Name.Symbol)
             {
                 errors.Add(new ScopeError(statement.SuperClass.Name, "A class can't inherit from itself."));
             }
@@ -157,7 +158,7 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
 
         foreach (var method in statement.Methods)
         {
-            var functionType = LoxClass.IsInitializer(method.Name.Lexeme) ?
+            var functionType = LoxClass.IsInitializer(method.Name.Symbol) ?
                 Scope.FunctionType.Initializer :
                 Scope.FunctionType.Method;
 
@@ -166,7 +167,7 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
 
         scope.ExitClass();
 
-        if (statement.SuperClass != null) scope.ExitClass();
+        if (statement.SuperClass != null) scope.ExitSuperClass();
 
         return null;
     }
@@ -242,7 +243,7 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
     #endregion
 
     #region Helper Methods
-    public void Resolve(IEnumerable<Statement> statements)
+    private void Resolve(List<Statement> statements)
     {
         foreach (var statement in statements)
         {
@@ -254,7 +255,7 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
 
     private void Resolve(Expression expression) => expression.Accept(this);
 
-    private void ResolveLocal(Expression expression, Token name) => scope.ResolveLocal(expression, name.Lexeme);
+    private void ResolveLocal(IResolvable expression, Token name) => scope.ResolveLocal(expression, name.Symbol);
 
     private void ResolveFunction(FunctionStatement function, Scope.FunctionType type)
     {
@@ -271,14 +272,14 @@ public class Resolver : Expression.IVisitor<object?>, Statement.IVisitor<object?
 
     private void Declare(Token name)
     {
-        if (!scope.Declare(name.Lexeme))
+        if (!scope.Declare(name.Symbol))
         {
             errors.Add(new ScopeError(name, "There is already a variable with this name in this scope."));
         }
     }
 
-    private void Define(Token name) => scope.Define(name.Lexeme);
+    private void Define(Token name) => scope.Define(name.Symbol);
 
-    private bool Initialize(Token name) => scope.Initialize(name.Lexeme);
+    private bool Initialize(Token name) => scope.Initialize(name.Symbol);
     #endregion
 }
@@ -1,10 +1,10 @@
 ﻿using Interpreter.Framework.AST;
 using Interpreter.Framework.Evaluating;
+using Interpreter.Framework.Scanning;
 
 namespace Interpreter.Framework.StaticAnalysis;
 internal class Scope
 {
-    private readonly AstInterpreter interpreter;
     private ScopeLevel? scope = null;
     private readonly Stack<FunctionType> currentFunction = new();
     private readonly Stack<ClassType> currentClass = new();
@@ -24,9 +24,8 @@ internal class Scope
         SubClass,
     }
 
-    public Scope(AstInterpreter interpreter)
+    public Scope()
     {
-        this.interpreter = interpreter;
         currentFunction.Push(FunctionType.None);
         currentClass.Push(ClassType.None);
     }
@@ -53,6 +52,8 @@ internal class Scope
         Initialize(LoxClass.SUPER);
     }
 
+    public void ExitSuperClass() => ExitBlock();
+
     public void EnterClass(ClassType classType)
     {
         currentClass.Push(classType);
@@ -66,11 +67,11 @@ internal class Scope
         currentClass.Pop();
     }
 
-    public bool Declare(string name) => scope?.Declare(name) ?? true;
+    public bool Declare(Symbol name) => scope?.Declare(name) ?? true;
 
-    public void Define(string name) => scope?.Define(name);
+    public void Define(Symbol name) => scope?.Define(name);
 
-    public bool Initialize(string name)
+    public bool Initialize(Symbol name)
     {
         if (!Declare(name)) return false;
         Define(name);
@@ -85,45 +86,54 @@ internal class Scope
 
     public bool InSubClass => currentClass.Peek() == ClassType.SubClass;
 
-    public bool IsDeclared(string name) => scope?.IsDeclared(name) ?? false;
+    public bool IsDeclared(Symbol name) => scope?.IsDeclared(name) ?? false;
 
-    public bool IsDefined(string name) => scope?.IsDefined(name) ?? false;
+    public bool IsDefined(Symbol name) => scope?.IsDefined(name) ?? false;
 
-    public void ResolveLocal(Expression expression, string name) => scope?.ResolveLocal(interpreter, expression, name, 0);
+    public void ResolveLocal(IResolvable expression, Symbol name) => scope?.ResolveLocal(expression, name, 0);
 
     class ScopeLevel
     {
-        private readonly Dictionary<string, bool> values = new();
+        private readonly Dictionary<Symbol, Variable> values = new();
 
         public readonly ScopeLevel? Previous;
 
         public ScopeLevel(ScopeLevel? previous) { Previous = previous; }
 
-        public bool Declare(string name)
+        // Slots are handed out in declaration order, matching the order the interpreter defines them at runtime.
+        public bool Declare(Symbol name)
         {
             if (IsDeclared(name)) return false;
 
-            values.Add(name, false);
+            values.Add(name, new Variable(values.Count));
 
             return true;
         }
 
-        public void Define(string name) => values[name] = true;
+        public void Define(Symbol name) => values[name].IsDefined = true;
 
-        public bool IsDeclared(string name) => values.ContainsKey(name);
+        public bool IsDeclared(Symbol name) => values.ContainsKey(name);
 
-        public bool IsDefined(string name) => IsDeclared(name) && values[name] == true;
+        public bool IsDefined(Symbol name) => values.TryGetValue(name, out var variable) && variable.IsDefined;
 
-        public void ResolveLocal(AstInterpreter interpreter, Expression expression, string name, int distance)
+        public void ResolveLocal(IResolvable expression, Symbol name, int distance)
         {
-            if (IsDeclared(name))
+            if (values.TryGetValue(name, out var variable))
             {
-                interpreter.Resolve(expression, distance);
+                expression.Local = (distance, variable.Slot);
             }
             else
             {
-                Previous?.ResolveLocal(interpreter, expression, name, distance + 1);
+                Previous?.ResolveLocal(expression, name, distance + 1);
             }
         }
+
+        class Variable
+        {
+            public readonly int Slot;
+            public bool IsDefined = false;
+
+            public Variable(int slot) { Slot = slot; }
+        }
     }
 }
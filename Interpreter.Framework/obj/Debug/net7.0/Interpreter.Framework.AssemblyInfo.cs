@@ -0,0 +1,22 @@
+//------------------------------------------------------------------------------
+// <auto-generated>
+//     This code was generated by a tool.
+//
+//     Changes to this file may cause incorrect behavior and will be lost if
+//     the code is regenerated.
+// </auto-generated>
+//------------------------------------------------------------------------------
+
+using System;
+using System.Reflection;
+
+[assembly: System.Reflection.AssemblyCompanyAttribute("Interpreter.Framework")]
+[assembly: System.Reflection.AssemblyConfigurationAttribute("Debug")]
+[assembly: System.Reflection.AssemblyFileVersionAttribute("0.1.0.0")]
+[assembly: System.Reflection.AssemblyInformationalVersionAttribute("0.1+01a45692941628a57ea87f5469678468d6a69b32")]
+[assembly: System.Reflection.AssemblyProductAttribute("Interpreter.Framework")]
+[assembly: System.Reflection.AssemblyTitleAttribute("Interpreter.Framework")]
+[assembly: System.Reflection.AssemblyVersionAttribute("0.1.0.0")]
+
+// Generated by the MSBuild WriteCodeFragment class.
+
@@ -0,0 +1,22 @@
+//------------------------------------------------------------------------------
+// <auto-generated>
+//     This code was generated by a tool.
+//
+//     Changes to this file may cause incorrect behavior and will be lost if
+//     the code is regenerated.
+// </auto-generated>
+//------------------------------------------------------------------------------
+
+using System;
+using System.Reflection;
+
+[assembly: System.Reflection.AssemblyCompanyAttribute("Interpreter.Framework")]
+[assembly: System.Reflection.AssemblyConfigurationAttribute("Release")]
+[assembly: System.Reflection.AssemblyFileVersionAttribute("0.1.0.0")]
+[assembly: System.Reflection.AssemblyInformationalVersionAttribute("0.1+28fd431d9376537d71fc406701e584b030e26272")]
+[assembly: System.Reflection.AssemblyProductAttribute("Interpreter.Framework")]
+[assembly: System.Reflection.AssemblyTitleAttribute("Interpreter.Framework")]
+[assembly: System.Reflection.AssemblyVersionAttribute("0.1.0.0")]
+
+// Generated by the MSBuild WriteCodeFragment class.
+
@@ -16,18 +16,18 @@ internal class Program
             "Expression",
             new string[]
             {
-                "Assignment : Token Name, Expression Value",
+                "Assignment : Token Name, Expression Value : IResolvable",
                 "Binary     : Expression Left, Token Operator, Expression Right",
                 "Call       : Expression Callee, Token Paren, List<Expression> Arguments",
-                "Get        : Expression LoxObject, Token Name",
+                "Get        : Expression LoxObject, Token Name : PropertyCache",
                 "Grouping   : Expression Expression",
                 "Literal    : object? Value",
                 "Logical    : Expression Left, Token Operator, Expression Right",
-                "Set        : Expression LoxObject, Token Name, Expression Value",
-                "Super      : Token Keyword, Token Method",
-                "This       : Token Keyword",
+                "Set        : Expression LoxObject, Token Name, Expression Value : PropertyCache",
+                "Super      : Token Keyword, Token Method : IResolvable",
+                "This       : Token Keyword : IResolvable",
                 "Unary      : Token Operator, Expression Right",
-                "Variable   : Token Name",
+                "Variable   : Token Name : IResolvable",
             }
         );
 
@@ -54,10 +54,20 @@ internal class Program
 
     private const string VISITOR = "IVisitor";
 
+    // Types listed with this after their fields carry the Resolver's result for the variable they name.
+    private const string RESOLVABLE = "IResolvable";
+
+    // Types listed with this after their fields carry the inline cache for the property they access.
+    private const string CACHED = "PropertyCache";
+
     private static void DefineAst(string outputDir, string baseName, IEnumerable<string> types)
     {
         using var writer = new StreamWriter(Path.Combine(outputDir, $"{baseName}.cs"));
 
+        if (types.Any(type => Marker(type) == CACHED))
+        {
+            writer.WriteLine($"using Interpreter.Framework.Evaluating;");
+        }
         writer.WriteLine($"using Interpreter.Framework.Scanning;");
         writer.WriteLine();
         writer.WriteLine("namespace Interpreter.Framework.AST;");
@@ -79,12 +89,19 @@ internal class Program
             var parts = type.Split(':');
             var className = $"{parts[0].Trim()}{baseName}";
             var fields = parts[1].Trim();
+            var marker = Marker(type);
 
             writer.WriteLine();
-            writer.WriteLine(DefineType(baseName, className, fields));
+            writer.WriteLine(DefineType(baseName, className, fields, marker == RESOLVABLE, marker == CACHED));
         }
     }
 
+    private static string? Marker(string type)
+    {
+        var parts = type.Split(':');
+        return parts.Length > 2 ? parts[2].Trim() : null;
+    }
+
     private static string DefineVisitor(string baseName, IEnumerable<string> types)
     {
         var sb = new StringBuilder();
@@ -106,14 +123,28 @@ internal class Program
         return sb.ToString();
     }
 
-    private static string DefineType(string baseName, string className, string fields)
+    private static string DefineType(string baseName, string className, string fields, bool resolvable, bool cached)
     {
         var sb = new StringBuilder();
 
-        sb.AppendLine($"{Indent()}public record class {className}({fields}) : {baseName}");
+        var baseTypes = resolvable ? $"{baseName}, {RESOLVABLE}" : baseName;
+
+        sb.AppendLine($"{Indent()}public record class {className}({fields}) : {baseTypes}");
         sb.AppendLine($"{Indent()}{{");
         indentLevel++;
 
+        if (resolvable)
+        {
+            sb.AppendLine($"{Indent()}public (int distance, int slot)? Local {{ get; set; }}");
+            sb.AppendLine();
+        }
+
+        if (cached)
+        {
+            sb.AppendLine($"{Indent()}internal {CACHED} Cache {{ get; }} = new();");
+            sb.AppendLine();
+        }
+
         sb.AppendLine($"{Indent()}public override T Accept<T>({VISITOR}<T> visitor) => visitor.Visit{className}(this);");
 
         indentLevel--;
@@ -0,0 +1,22 @@
+//------------------------------------------------------------------------------
+// <auto-generated>
+//     This code was generated by a tool.
+//
+//     Changes to this file may cause incorrect behavior and will be lost if
+//     the code is regenerated.
+// </auto-generated>
+//------------------------------------------------------------------------------
+
+using System;
+using System.Reflection;
+
+[assembly: System.Reflection.AssemblyCompanyAttribute("generate_ast")]
+[assembly: System.Reflection.AssemblyConfigurationAttribute("Debug")]
+[assembly: System.Reflection.AssemblyFileVersionAttribute("0.1.0.0")]
+[assembly: System.Reflection.AssemblyInformationalVersionAttribute("0.1+931d85a01b294281c38345fec6d35d4064be655b")]
+[assembly: System.Reflection.AssemblyProductAttribute("generate_ast")]
+[assembly: System.Reflection.AssemblyTitleAttribute("generate_ast")]
+[assembly: System.Reflection.AssemblyVersionAttribute("0.1.0.0")]
+
+// Generated by the MSBuild WriteCodeFragment class.
+
@@ -5,22 +5,32 @@ using Interpreter.Framework.Scanning;
 using Interpreter.Framework.StaticAnalysis;
 
 namespace Interpreter.Tests.EvaluatingTests;
-internal static class AstInterpreterTests
+[TestFixture(Backend.Visitor)]
+[TestFixture(Backend.Closures)]
+[TestFixture(Backend.ExpressionTrees)]
+internal class AstInterpreterTests
 {
     #region Setup and Teardown
-    private static AstInterpreter interpreter;
+    private readonly Backend backend;
 
-    private static readonly List<string> output = new();
+    private AstInterpreter interpreter;
 
-    private static void OnOutput(object? sender, InterpreterOutEventArgs output)
+    private readonly List<string> output = new();
+
+    public AstInterpreterTests(Backend backend)
+    {
+        this.backend = backend;
+    }
+
+    private void OnOutput(object? sender, InterpreterOutEventArgs output)
     {
-        AstInterpreterTests.output.Add(output.Content);
+        this.output.Add(output.Content);
     }
 
     [SetUp]
-    public static void Setup()
+    public void Setup()
     {
-        interpreter = new AstInterpreter();
+        interpreter = new AstInterpreter(backend);
 
         interpreter.Out += OnOutput;
 
@@ -28,14 +38,14 @@ internal static class AstInterpreterTests
     }
 
     [TearDown]
-    public static void TearDown()
+    public void TearDown()
     {
         interpreter.Out -= OnOutput;
     }
     #endregion
 
     [Test]
-    public static void Interpreter_StartsWithBlankState()
+    public void Interpreter_StartsWithBlankState()
     {
         var input = "print a;";
 
@@ -45,7 +55,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Interpreter_CanBeReset()
+    public void Interpreter_CanBeReset()
     {
         var input = """
         var a = 1;
@@ -64,7 +74,7 @@ internal static class AstInterpreterTests
 
     #region Binary Expressions
     [Test]
-    public static void Binary_Plus_Numbers()
+    public void Binary_Plus_Numbers()
     {
         var input = "print 1 + 1;";
 
@@ -74,7 +84,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_Plus_Strings()
+    public void Binary_Plus_Strings()
     {
         var input = """print "foo" + "bar";""";
 
@@ -85,7 +95,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Plus_Invalid()
+    public void Binary_Plus_Invalid()
     {
         var input = """print 1 + "foo";""";
 
@@ -96,7 +106,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Minus_Valid()
+    public void Binary_Minus_Valid()
     {
         var input = "print 3.14 - 1;";
 
@@ -107,7 +117,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Minus_Invalid()
+    public void Binary_Minus_Invalid()
     {
         var inputs = new List<string>
         {
@@ -124,7 +134,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_Slash_Valid()
+    public void Binary_Slash_Valid()
     {
         var input = "print 9 / 3;";
 
@@ -135,7 +145,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Slash_Invalid()
+    public void Binary_Slash_Invalid()
     {
         var inputs = new List<string>
         {
@@ -152,7 +162,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_Star_Valid()
+    public void Binary_Star_Valid()
     {
         var input = "print 4 * 5;";
 
@@ -163,7 +173,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Star_Invalid()
+    public void Binary_Star_Invalid()
     {
         var inputs = new List<string>
         {
@@ -180,7 +190,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_Greater_Valid()
+    public void Binary_Greater_Valid()
     {
         var input = """
         print 7 >= 8;
@@ -194,7 +204,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Greater_Invalid()
+    public void Binary_Greater_Invalid()
     {
         var inputs = new List<string>
         {
@@ -211,7 +221,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_GreaterEqual_Valid()
+    public void Binary_GreaterEqual_Valid()
     {
         var input = """
         print 10 >= 11;
@@ -224,7 +234,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_GreaterEqual_Invalid()
+    public void Binary_GreaterEqual_Invalid()
     {
         var inputs = new List<string>
         {
@@ -241,7 +251,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_Less_Valid()
+    public void Binary_Less_Valid()
     {
         var input = """
         print 13 < 14;
@@ -255,7 +265,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Binary_Less_Invalid()
+    public void Binary_Less_Invalid()
     {
         var inputs = new List<string>
         {
@@ -272,7 +282,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_LessEqual_Valid()
+    public void Binary_LessEqual_Valid()
     {
         var input = """
         print 16 <= 16;
@@ -285,7 +295,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_LessEqual_Invalid()
+    public void Binary_LessEqual_Invalid()
     {
         var inputs = new List<string>
         {
@@ -302,7 +312,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_BangEqual_Valid()
+    public void Binary_BangEqual_Valid()
     {
         var input = """
         print 19 != 20;
@@ -318,7 +328,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Binary_EqualEqual_Valid()
+    public void Binary_EqualEqual_Valid()
     {
         var input = """
         print 19 == 20;
@@ -336,7 +346,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void GroupingExpression()
+    public void GroupingExpression()
     {
         var input = "print 6 / ( 3 - 1 );";
 
@@ -346,7 +356,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void LogicalExpression_Or_False()
+    public void LogicalExpression_Or_False()
     {
         var input = "print false or 1;";
 
@@ -356,7 +366,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void LogicalExpression_Or_True()
+    public void LogicalExpression_Or_True()
     {
         var input = "print true or 1;";
 
@@ -366,7 +376,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void LogicalExpression_And_False()
+    public void LogicalExpression_And_False()
     {
         var input = "print false and 1;";
 
@@ -376,7 +386,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void LogicalExpression_And_True()
+    public void LogicalExpression_And_True()
     {
         var input = "print true and 1;";
 
@@ -386,7 +396,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void UnaryExpression_Minus_Valid()
+    public void UnaryExpression_Minus_Valid()
     {
         var input = """
         print -1;
@@ -400,7 +410,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void UnaryExpression_Minus_Invalid()
+    public void UnaryExpression_Minus_Invalid()
     {
         var input = "-true;";
 
@@ -410,7 +420,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void UnaryExpression_Bang_Valid()
+    public void UnaryExpression_Bang_Valid()
     {
         var input = """
         print !nil;
@@ -432,7 +442,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Variables()
+    public void Variables()
     {
         var input = """
         var a;
@@ -447,7 +457,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Variable_UnitializedIsNil()
+    public void Variable_UnitializedIsNil()
     {
         var input = "var a; print a;";
 
@@ -458,7 +468,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Block()
+    public void Block()
     {
         var input = """
         var a = 7;
@@ -478,7 +488,7 @@ internal static class AstInterpreterTests
 
 
     [Test]
-    public static void Block_VariablesUndefinedAfterBlock()
+    public void Block_VariablesUndefinedAfterBlock()
     {
         var input = """
         {
@@ -495,7 +505,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Block_VariablesUndefinedRecursiveLookup()
+    public void Block_VariablesUndefinedRecursiveLookup()
     {
         var input = """
         {
@@ -509,7 +519,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_Minimal()
+    public void Class_Minimal()
     {
         var input = """
         class Foo { }
@@ -526,7 +536,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_WithMethods()
+    public void Class_WithMethods()
     {
         var input = """
         class Foo {
@@ -550,7 +560,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_SuperClassMustBeClass()
+    public void Class_SuperClassMustBeClass()
     {
         var input = """
         var Foo = 1;
@@ -564,7 +574,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_CanInheritFromSuper()
+    public void Class_CanInheritFromSuper()
     {
         var input = """
         class Foo {
@@ -588,7 +598,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_CanOverrideInheritFromSuper()
+    public void Class_CanOverrideInheritFromSuper()
     {
         var input = """
         class Foo {
@@ -616,7 +626,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_CanCallSuperMethod()
+    public void Class_CanCallSuperMethod()
     {
         var input = """
         class Foo {
@@ -636,7 +646,32 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Class_UndefinedSuperMethod()
+    public void Class_TwoSubClassesCallSuperMethods()
+    {
+        var input = """
+        class Foo {
+            baz() { print 1; }
+        }
+
+        class Bar : Foo {
+            baz() { super.baz(); print 2; }
+        }
+
+        class Qux : Foo {
+            baz() { super.baz(); print 3; }
+        }
+
+        Bar().baz();
+        Qux().baz();
+        """;
+
+        var expected = new string[] { "1", "2", "1", "3" };
+
+        AssertInputGeneratesProperOutputs(input, expected);
+    }
+
+    [Test]
+    public void Class_UndefinedSuperMethod()
     {
         var input = """
         class Foo { }
@@ -654,7 +689,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Get_OnlyOnInstance()
+    public void Get_OnlyOnInstance()
     {
         var input = "1.ToString();";
 
@@ -664,7 +699,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Get_Undefined()
+    public void Get_Undefined()
     {
         var input = """
         class Foo { }
@@ -680,7 +715,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Set_OnlyOnInstance()
+    public void Set_OnlyOnInstance()
     {
         var input = "1.foo = 2;";
 
@@ -690,7 +725,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void For()
+    public void For()
     {
         var input = """
         var a = 0;
@@ -716,7 +751,20 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_InvalidArity()
+    public void For_InFunctionOnOneLine()
+    {
+        // Identical expressions on the same line are resolved separately.
+        var input = """
+        fun f() { var s = 0; for (var i = 0; i < 3; i = i + 1) { var j = i; s = s + j; } print s; }
+
+        f();
+        """;
+
+        AssertInputGeneratesProperOutput(input, "3");
+    }
+
+    [Test]
+    public void Function_InvalidArity()
     {
         var input = """
         fun foo() { print true; }
@@ -730,7 +778,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_NotAFunction()
+    public void Function_NotAFunction()
     {
         var input = "true();";
 
@@ -740,7 +788,23 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_NoArgs()
+    public void Function_CallAfterErrorInArguments()
+    {
+        var input = """
+        fun add(a, b) { return a + b; }
+
+        print add(1, add(2, nil));
+        """;
+
+        AssertInputGeneratesProperError(input, "Operands must be two numbers or two strings.");
+
+        output.Clear();
+
+        AssertInputGeneratesProperOutput("print add(3, 4);", "7");
+    }
+
+    [Test]
+    public void Function_NoArgs()
     {
         var input = """
         fun foo() { print true; }
@@ -754,7 +818,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_WithArgs()
+    public void Function_WithArgs()
     {
         var input = """
         fun foo( a, b, c ) { print a + b + c; }
@@ -768,7 +832,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_Print()
+    public void Function_Print()
     {
         var input = """
         fun foo( a, b, c ) { print a + b + c; }
@@ -782,7 +846,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_ReturnStatement()
+    public void Function_ReturnStatement()
     {
         var input = """
         fun foo( a, b, c ) { return a + b + c; }
@@ -796,7 +860,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_EarlyReturn()
+    public void Function_EarlyReturn()
     {
         var input = """
         fun foo( a, b, c ) {
@@ -813,7 +877,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Function_LocalFunction()
+    public void Function_LocalFunction()
     {
         var input = """
         fun makeCounter() {
@@ -839,7 +903,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void If_True_NoElse()
+    public void If_True_NoElse()
     {
         var input = """
         if ( true ) print 1;
@@ -851,7 +915,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void If_False_NoElse()
+    public void If_False_NoElse()
     {
         var input = """
         if ( false ) print 1;
@@ -861,7 +925,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void If_True_WithElse()
+    public void If_True_WithElse()
     {
         var input = """
         if ( true ) print 1; else print 2;
@@ -873,7 +937,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void If_False_WithElse()
+    public void If_False_WithElse()
     {
         var input = """
         if ( false ) print 1; else print 2;
@@ -885,7 +949,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Print()
+    public void Print()
     {
         var input = "print 3.14;";
 
@@ -895,7 +959,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void While()
+    public void While()
     {
         var input = """
         var i = 0;
@@ -917,7 +981,7 @@ internal static class AstInterpreterTests
 
     #region Globals
     [Test]
-    public static void Global_Clock()
+    public void Global_Clock()
     {
         var input = "print clock();";
 
@@ -931,7 +995,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Global_Reset()
+    public void Global_Reset()
     {
         var input = """
         var a = 1;
@@ -947,7 +1011,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Global_FunctionsPrinted()
+    public void Global_FunctionsPrinted()
     {
         var input = """
         print clock;
@@ -966,7 +1030,7 @@ internal static class AstInterpreterTests
 
     #region Resolving
     [Test]
-    public static void Variable_Preceding()
+    public void Variable_Preceding()
     {
         var input = """
         var a = "outer";
@@ -983,7 +1047,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Variable_Innermost()
+    public void Variable_Innermost()
     {
         var input = """
         var a = "outer";
@@ -1000,7 +1064,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Variable_InnerShadowOfGlobal()
+    public void Variable_InnerShadowOfGlobal()
     {
         var input = """
         var a = "global";
@@ -1025,7 +1089,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Variable_GlobalCanBeRedeclared()
+    public void Variable_GlobalCanBeRedeclared()
     {
         var input = """
         var a = 0;
@@ -1040,7 +1104,7 @@ internal static class AstInterpreterTests
     }
 
     [Test]
-    public static void Variable_NestedScopes()
+    public void Variable_NestedScopes()
     {
         var input = """
         var a = 0;
@@ -1076,9 +1140,9 @@ internal static class AstInterpreterTests
     #endregion
 
     #region Helper Methods
-    private static LoxRuntimeError? ProcessInput(string input)
+    private LoxRuntimeError? ProcessInput(string input)
     {
-        var (tokens, scanErrors) = Scanner.ScanTokens(input);
+        var (tokens, scanErrors) = Scanner.ScanTokens(input, interpreter.Names);
 
         Assert.That(scanErrors, Is.Empty);
 
@@ -1086,29 +1150,29 @@ internal static class AstInterpreterTests
 
         Assert.That(parseErrors, Is.Empty);
 
-        var scopeErrors = Resolver.Resolve(interpreter, statements);
+        var scopeErrors = Resolver.Resolve(statements);
 
         Assert.That(scopeErrors, Is.Empty);
 
         return interpreter.Interpret(statements);
     }
 
-    private static void AssertInputGeneratesProperOutput(string input, string expected) =>
+    private void AssertInputGeneratesProperOutput(string input, string expected) =>
         AssertInputGeneratesExpected(input, null, expected);
 
-    private static void AssertInputGeneratesProperOutputs(string input, IEnumerable<string> expected) =>
+    private void AssertInputGeneratesProperOutputs(string input, IEnumerable<string> expected) =>
         AssertInputGeneratesExpected(input, null, expected);
 
-    private static void AssertInputGeneratesNoOutput(string input) =>
+    private void AssertInputGeneratesNoOutput(string input) =>
         AssertInputGeneratesExpected(input, null);
 
-    private static void AssertInputGeneratesProperError(string input, string expected) =>
+    private void AssertInputGeneratesProperError(string input, string expected) =>
         AssertInputGeneratesExpected(input, expected);
 
-    private static void AssertInputGeneratesExpected(string input, string? expectedError = null, params string[] expectedOutput) =>
+    private void AssertInputGeneratesExpected(string input, string? expectedError = null, params string[] expectedOutput) =>
         AssertInputGeneratesExpected(input, expectedError, expectedOutput.ToList());
 
-    private static void AssertInputGeneratesExpected(string input, string? expectedError, IEnumerable<string> expectedOutput)
+    private void AssertInputGeneratesExpected(string input, string? expectedError, IEnumerable<string> expectedOutput)
     {
         var error = ProcessInput(input);
 
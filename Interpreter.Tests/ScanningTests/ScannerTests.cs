@@ -222,6 +222,29 @@ internal static class ScannerTests
         AssertInputGeneratesProperTokens(input, expected, 8, Environment.NewLine);
     }
 
+    [Test]
+    public static void IdentifiersAreInterned()
+    {
+        var tokens = Scanner.ScanTokens("foo = foo + 12 + 12 + \"foo\";").tokens.ToList();
+
+        Assert.That(tokens[2].Symbol, Is.SameAs(tokens[0].Symbol));
+        Assert.That(tokens[6].Lexeme, Is.EqualTo(tokens[4].Lexeme));
+        Assert.That(tokens[6].Literal, Is.EqualTo(12.0));
+        Assert.That(tokens[8].Literal, Is.EqualTo("foo"));
+    }
+
+    [Test]
+    public static void IdentifiersShareSymbols()
+    {
+        var (tokens, _) = Scanner.ScanTokens("class foo { bar() { this.foo = foo; } }");
+
+        var foos = tokens.Where(t => t.Lexeme == "foo").Select(t => t.Symbol).ToList();
+
+        Assert.That(foos, Has.Count.EqualTo(3));
+        Assert.That(foos.Distinct().Count(), Is.EqualTo(1));
+        Assert.That(tokens.Single(t => t.Type == TokenType.THIS).Symbol, Is.SameAs(Symbol.For("this")));
+    }
+
     #region Helper Methods
     private static void AssertInputGeneratesProperTokens(string input, string expected, int finalLine = 1, string joiner = " ")
     {
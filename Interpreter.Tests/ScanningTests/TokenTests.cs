@@ -8,7 +8,7 @@ internal class TokenTests
     [Test]
     public void StandardToken()
     {
-        var token = new Token(TokenType.IDENTIFIER, "foo", 1);
+        var token = new Token(TokenType.IDENTIFIER, Symbol.For("foo"), 1);
 
         Assert.That(token.ToString(), Is.EqualTo("1 IDENTIFIER foo "));
     }
@@ -16,7 +16,7 @@ internal class TokenTests
     [Test]
     public void LiteralToken()
     {
-        var token = new Token(TokenType.NUMBER, "123", 1, (double)123);
+        var token = new Token(TokenType.NUMBER, Symbol.For("123"), 1, (double)123);
 
         Assert.That(token.ToString(), Is.EqualTo("1 NUMBER 123 123"));
     }
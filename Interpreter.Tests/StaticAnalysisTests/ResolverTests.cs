@@ -1,5 +1,4 @@
-﻿using Interpreter.Framework.Evaluating;
-using Interpreter.Framework.Parsing;
+﻿using Interpreter.Framework.Parsing;
 using Interpreter.Framework.Scanning;
 using Interpreter.Framework.StaticAnalysis;
 
@@ -123,7 +122,7 @@ internal static class ResolverTests
 
         Assert.That(parseErrors, Is.Empty);
 
-        var scopeErrors = Resolver.Resolve(new AstInterpreter(), statements);
+        var scopeErrors = Resolver.Resolve(statements);
 
         return scopeErrors.ToList();
     }
@@ -1,4 +1,5 @@
-﻿using System.Reflection;
+﻿using Interpreter.Framework.Evaluating;
+using System.Reflection;
 using static Interpreter.Framework.Interpreter;
 using static Interpreter.Framework.InterpreterErrorEventArgs;
 
@@ -46,10 +47,17 @@ internal class Program
             };
         }
 
+        if (args.Length > 1 && args[0] == "--backend")
+        {
+            if (!Enum.TryParse<Backend>(args[1], true, out var backend)) Usage();
+
+            Interpreter.Framework.Interpreter.Backend = backend;
+            args = args[2..];
+        }
+
         if (args.Length > 1)
         {
-            Console.WriteLine("Usage: lox [script]");
-            Environment.Exit(1);
+            Usage();
         }
         else if (args.Length == 1)
         {
@@ -61,6 +69,12 @@ internal class Program
         }
     }
 
+    static void Usage()
+    {
+        Console.WriteLine("Usage: lox [--backend visitor|closures|expressiontrees] [script]");
+        Environment.Exit(1);
+    }
+
     static void RunFile(string path) => Run(File.ReadAllText(path));
 
     static void RunPrompt()
@@ -0,0 +1,22 @@
+//------------------------------------------------------------------------------
+// <auto-generated>
+//     This code was generated by a tool.
+//
+//     Changes to this file may cause incorrect behavior and will be lost if
+//     the code is regenerated.
+// </auto-generated>
+//------------------------------------------------------------------------------
+
+using System;
+using System.Reflection;
+
+[assembly: System.Reflection.AssemblyCompanyAttribute("lox")]
+[assembly: System.Reflection.AssemblyConfigurationAttribute("Debug")]
+[assembly: System.Reflection.AssemblyFileVersionAttribute("0.1.0.0")]
+[assembly: System.Reflection.AssemblyInformationalVersionAttribute("0.1+8b95b6fc9489e92a8d0955a9932c196263c51777")]
+[assembly: System.Reflection.AssemblyProductAttribute("lox")]
+[assembly: System.Reflection.AssemblyTitleAttribute("lox")]
+[assembly: System.Reflection.AssemblyVersionAttribute("0.1.0.0")]
+
+// Generated by the MSBuild WriteCodeFragment class.
+
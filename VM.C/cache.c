@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "memory.h"
+#include "vm.h"
+
+#define CACHE_MAGIC "LOXC"
+#define CACHE_EXTENSION ".loxc"
+#define SOURCE_EXTENSION ".lox"
+
+typedef enum ConstantTag {
+    CONSTANT_NIL,
+    CONSTANT_FALSE,
+    CONSTANT_TRUE,
+    CONSTANT_NUMBER,
+    CONSTANT_STRING,
+    CONSTANT_FUNCTION,
+} ConstantTag;
+
+typedef struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t sourceHash;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+} CacheHeader;
+
+typedef struct Reader {
+    const uint8_t* start;
+    const uint8_t* current;
+    const uint8_t* end;
+    bool hadError;
+} Reader;
+
+char* cachePath(const char* sourcePath) {
+    size_t length = strlen(sourcePath);
+    size_t sourceExtension = strlen(SOURCE_EXTENSION);
+    bool isLoxFile = length >= sourceExtension &&
+        strcmp(sourcePath + length - sourceExtension, SOURCE_EXTENSION) == 0;
+
+    const char* suffix = isLoxFile ? "c" : CACHE_EXTENSION;
+    size_t size = length + strlen(suffix) + 1;
+
+    char* path = (char*)malloc(size);
+    if (path == NULL) return NULL;
+
+    memcpy(path, sourcePath, length);
+    memcpy(path + length, suffix, size - length);
+    return path;
+}
+
+static bool stampSource(const char* sourcePath, const char* source, CacheHeader* header) {
+    struct stat info;
+    if (stat(sourcePath, &info) != 0) return false;
+
+    memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+    header->version = CACHE_VERSION;
+    header->sourceHash = hashString(source, (int)strlen(source));
+    header->reserved = 0;
+    header->sourceSize = (uint64_t)info.st_size;
+    header->sourceTime = (int64_t)info.st_mtime;
+    return true;
+}
+
+static void writeFunction(FILE* file, ObjectFunction* function);
+
+static void writeInt(FILE* file, int32_t value) {
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+static void writeString(FILE* file, ObjectString* string) {
+    writeInt(file, string->length);
+    fwrite(string->chars, sizeof(char), string->length, file);
+}
+
+static void writeValue(FILE* file, Value value) {
+    if (IS_NIL(value)) {
+        fputc(CONSTANT_NIL, file);
+    }
+    else if (IS_BOOL(value)) {
+        fputc(AS_BOOL(value) ? CONSTANT_TRUE : CONSTANT_FALSE, file);
+    }
+    else if (IS_NUMBER(value)) {
+        double number = AS_NUMBER(value);
+        fputc(CONSTANT_NUMBER, file);
+        fwrite(&number, sizeof(number), 1, file);
+    }
+    else if (IS_STRING(value)) {
+        fputc(CONSTANT_STRING, file);
+        writeString(file, AS_STRING(value));
+    }
+    else if (IS_FUNCTION(value)) {
+        fputc(CONSTANT_FUNCTION, file);
+        writeFunction(file, AS_FUNCTION(value));
+    }
+}
+
+static void writeFunction(FILE* file, ObjectFunction* function) {
+    writeInt(file, function->arity);
+    writeInt(file, function->upValueCount);
+    writeInt(file, function->maxSlots);
+
+    if (function->name == NULL) {
+        writeInt(file, -1);
+    }
+    else {
+        writeString(file, function->name);
+    }
+
+    Chunk* chunk = &function->chunk;
+    writeInt(file, chunk->count);
+    fwrite(chunk->code, sizeof(uint8_t), chunk->count, file);
+    while (ftell(file) % sizeof(int) != 0) {
+        fputc(0, file);
+    }
+    writeInt(file, chunk->lineCount);
+    fwrite(chunk->lines, sizeof(LineStart), chunk->lineCount, file);
+
+    writeInt(file, chunk->constants.count);
+    for (int i = 0; i < chunk->constants.count; i++) {
+        writeValue(file, chunk->constants.values[i]);
+    }
+}
+
+bool writeCache(const char* path, const char* sourcePath, const char* source, ObjectFunction* function) {
+    CacheHeader header;
+    if (!stampSource(sourcePath, source, &header)) return false;
+
+    // Other processes may be running code straight out of a mapping of the old
+    // cache, so it is replaced rather than overwritten.
+    ReplacementFile file;
+    if (!openReplacement(path, &file)) return false;
+
+    fwrite(&header, sizeof(header), 1, file.stream);
+    writeFunction(file.stream, function);
+
+    return commitReplacement(&file);
+}
+
+static bool readBytes(Reader* reader, void* bytes, size_t size) {
+    if (reader->hadError || (size_t)(reader->end - reader->current) < size) {
+        reader->hadError = true;
+        return false;
+    }
+
+    memcpy(bytes, reader->current, size);
+    reader->current += size;
+    return true;
+}
+
+static void skipBytes(Reader* reader, size_t size) {
+    if (reader->hadError || (size_t)(reader->end - reader->current) < size) {
+        reader->hadError = true;
+        return;
+    }
+
+    reader->current += size;
+}
+
+static int32_t readInt(Reader* reader) {
+    int32_t value = 0;
+    readBytes(reader, &value, sizeof(value));
+    return value;
+}
+
+static ObjectString* readString(Reader* reader, int length) {
+    if (length < 0 || reader->end - reader->current < length) {
+        reader->hadError = true;
+        return NULL;
+    }
+
+    ObjectString* string = copyString((const char*)reader->current, length);
+    reader->current += length;
+    return string;
+}
+
+static ObjectFunction* readFunction(Reader* reader);
+
+static bool readValue(Reader* reader, Value* value) {
+    uint8_t tag;
+    if (!readBytes(reader, &tag, sizeof(tag))) return false;
+
+    switch (tag)
+    {
+    case CONSTANT_NIL:      *value = NIL_VALUE; return true;
+    case CONSTANT_FALSE:    *value = BOOL_VALUE(false); return true;
+    case CONSTANT_TRUE:     *value = BOOL_VALUE(true); return true;
+    case CONSTANT_NUMBER: {
+        double number;
+        if (!readBytes(reader, &number, sizeof(number))) return false;
+        *value = NUMBER_VALUE(number);
+        return true;
+    }
+    case CONSTANT_STRING: {
+        ObjectString* string = readString(reader, readInt(reader));
+        if (string == NULL) return false;
+        *value = OBJECT_VALUE(string);
+        return true;
+    }
+    case CONSTANT_FUNCTION: {
+        ObjectFunction* function = readFunction(reader);
+        if (function == NULL) return false;
+        *value = OBJECT_VALUE(function);
+        return true;
+    }
+    default:
+        reader->hadError = true;
+        return false;
+    }
+}
+
+static ObjectFunction* readFunction(Reader* reader) {
+    ObjectFunction* function = newFunction();
+    push(OBJECT_VALUE(function));
+
+    function->arity = readInt(reader);
+    function->upValueCount = readInt(reader);
+    function->maxSlots = readInt(reader);
+
+    int nameLength = readInt(reader);
+    if (nameLength >= 0) {
+        function->name = readString(reader, nameLength);
+    }
+
+    // Code and lines are used in place; the image stays mapped for the life of the VM.
+    Chunk* chunk = &function->chunk;
+    int count = readInt(reader);
+    const uint8_t* code = reader->current;
+    skipBytes(reader, sizeof(uint8_t) * count);
+    skipBytes(reader, (sizeof(int) - (reader->current - reader->start) % sizeof(int)) % sizeof(int));
+    int lineCount = readInt(reader);
+    const uint8_t* lines = reader->current;
+    skipBytes(reader, sizeof(LineStart) * lineCount);
+
+    if (reader->hadError || count < 0 || lineCount < 0) {
+        reader->hadError = true;
+        pop();
+        return NULL;
+    }
+
+    chunk->code = (uint8_t*)code;
+    chunk->count = count;
+    chunk->lines = (LineStart*)lines;
+    chunk->lineCount = lineCount;
+
+    int constantCount = readInt(reader);
+    for (int i = 0; i < constantCount && !reader->hadError; i++) {
+        Value value;
+        if (!readValue(reader, &value)) break;
+        addConstant(chunk, value);
+    }
+
+    pop();
+    return reader->hadError ? NULL : function;
+}
+
+ObjectFunction* loadCache(const MappedFile* image, const char* sourcePath, const char* source) {
+    CacheHeader expected;
+    if (!stampSource(sourcePath, source, &expected)) return NULL;
+
+    Reader reader = {
+        .start = (const uint8_t*)image->data,
+        .current = (const uint8_t*)image->data,
+        .end = (const uint8_t*)image->data + image->size,
+        .hadError = false
+    };
+
+    CacheHeader header;
+    if (!readBytes(&reader, &header, sizeof(header)) ||
+        memcmp(&header, &expected, sizeof(header)) != 0) {
+        return NULL;
+    }
+
+    ObjectFunction* function = readFunction(&reader);
+    if (reader.current != reader.end) return NULL;
+    return function;
+}
@@ -0,0 +1,13 @@
+#ifndef clox_cache_h
+#define clox_cache_h
+
+#include "file.h"
+#include "object.h"
+
+#define CACHE_VERSION 4
+
+char* cachePath(const char* sourcePath);
+ObjectFunction* loadCache(const MappedFile* image, const char* sourcePath, const char* source);
+bool writeCache(const char* path, const char* sourcePath, const char* source, ObjectFunction* function);
+
+#endif // !clox_cache_h
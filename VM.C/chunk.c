@@ -8,13 +8,19 @@ void initChunk(Chunk* chunk) {
     chunk->count = 0;
     chunk->capacity = 0;
     chunk->code = NULL;
+    chunk->lineCount = 0;
+    chunk->lineCapacity = 0;
     chunk->lines = NULL;
     initValueArray(&chunk->constants);
 }
 
 void freeChunk(Chunk* chunk) {
-    FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
-    FREE_ARRAY(int, chunk->lines, chunk->capacity);
+    if (chunk->capacity > 0) {
+        FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
+    }
+    if (chunk->lineCapacity > 0) {
+        FREE_ARRAY(LineStart, chunk->lines, chunk->lineCapacity);
+    }
     freeValueArray(&chunk->constants);
     initChunk(chunk);
 }
@@ -25,13 +31,23 @@ void writeChunk(Chunk* chunk, uint8_t byte, int line) {
         chunk->capacity = GROW_CAPACITY(oldCapacity);
         chunk->code = GROW_ARRAY(uint8_t, chunk->code,
             oldCapacity, chunk->capacity);
-        chunk->lines = GROW_ARRAY(int, chunk->lines,
-            oldCapacity, chunk->capacity);
     }
 
     chunk->code[chunk->count] = byte;
-    chunk->lines[chunk->count] = line;
     chunk->count++;
+
+    if (chunk->lineCount > 0 && chunk->lines[chunk->lineCount - 1].line == line) return;
+
+    if (chunk->lineCapacity < chunk->lineCount + 1) {
+        int oldCapacity = chunk->lineCapacity;
+        chunk->lineCapacity = GROW_CAPACITY(oldCapacity);
+        chunk->lines = GROW_ARRAY(LineStart, chunk->lines,
+            oldCapacity, chunk->lineCapacity);
+    }
+
+    LineStart* lineStart = &chunk->lines[chunk->lineCount++];
+    lineStart->offset = chunk->count - 1;
+    lineStart->line = line;
 }
 
 int addConstant(Chunk* chunk, Value value) {
@@ -39,4 +55,27 @@ int addConstant(Chunk* chunk, Value value) {
     writeValueArray(&chunk->constants, value);
     pop();
     return chunk->constants.count - 1;
-};
\ No newline at end of file
+};
+
+// Binary search for the last run starting at or before offset. Only reads the
+// chunk, so the sampling profiler can call it from its signal handler.
+int getLine(Chunk* chunk, int offset) {
+    int low = 0;
+    int high = chunk->lineCount - 1;
+    int line = 0;
+
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        LineStart* lineStart = &chunk->lines[middle];
+
+        if (lineStart->offset <= offset) {
+            line = lineStart->line;
+            low = middle + 1;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+
+    return line;
+}
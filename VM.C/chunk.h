@@ -35,6 +35,7 @@ typedef enum OpCode {
 	OP_JUMP_IF_FALSE,
 	OP_LOOP,
 	OP_CALL,
+	OP_TAIL_CALL,
 	OP_INVOKE,
 	OP_SUPER_INVOKE,
 	OP_CLOSURE,
@@ -43,13 +44,25 @@ typedef enum OpCode {
 	OP_CLASS,
 	OP_INHERIT,
 	OP_METHOD,
+	// Prefix giving the next instruction two byte constant, local and upvalue operands.
+	OP_WIDE,
 } OpCode;
 
+// Line numbers are run-length encoded: each entry gives the line of the bytecode
+// from its offset up to the offset of the next entry.
+typedef struct LineStart {
+	int offset;
+	int line;
+} LineStart;
+
+// A chunk with code but no capacity borrows code and lines from a mapped bytecode cache.
 typedef struct Chunk {
 	int count;
 	int capacity;
 	uint8_t* code;
-	int* lines;
+	int lineCount;
+	int lineCapacity;
+	LineStart* lines;
 	ValueArray constants;
 } Chunk;
 
@@ -57,5 +70,6 @@ void initChunk(Chunk* chunk);
 void freeChunk(Chunk* chunk);
 void writeChunk(Chunk* chunk, uint8_t byte, int line);
 int addConstant(Chunk* chunk, Value value);
+int getLine(Chunk* chunk, int offset);
 
 #endif // !clox_chunk_h
@@ -15,6 +15,13 @@
 #define DEBUG_LOG_GC
 #endif
 
+// Build with DEBUG_COUNT_OPCODES to have run() count opcodes and opcode pairs,
+// written as JSON by freeVM(); DEBUG_TIME_OPCODES also counts cycles with rdtsc.
+#ifdef DEBUG_TIME_OPCODES
+#define DEBUG_COUNT_OPCODES
+#endif
+
 #define UINT8_COUNT (UINT8_MAX + 1)
+#define UINT16_COUNT (UINT16_MAX + 1)
 
 #endif // !clox_common_h
\ No newline at end of file
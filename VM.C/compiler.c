@@ -11,8 +11,9 @@
 #include "debug.h"
 #endif // !DEBUG_PRINT_CODE
 
-#define UNINITIALIZED   -1
-#define MAX_ARGS        255
+#define UNINITIALIZED       -1
+#define MAX_ARGS            255
+#define CONSTANT_MAX_LOAD   0.5
 
 typedef struct Parse {
     Token current;
@@ -50,7 +51,7 @@ typedef struct Local {
 } Local;
 
 typedef struct UpValue {
-    uint8_t index;
+    uint16_t index;
     bool isLocal;
 } UpValue;
 
@@ -66,10 +67,17 @@ typedef struct Compiler {
     ObjectFunction* function;
     FunctionType type;
 
-    Local locals[UINT8_COUNT];
+    Local* locals;
     int localCount;
-    UpValue upValues[UINT8_COUNT];
+    int localCapacity;
+    UpValue* upValues;
+    int upValueCapacity;
+    // Open addressing index from a constant to its slot in the chunk, so a
+    // repeated literal or name shares one slot.
+    int* constantSlots;
+    int constantCapacity;
     int scopeDepth;
+    int lastCall;
 } Compiler;
 
 typedef struct ClassCompiler {
@@ -156,6 +164,17 @@ static void emitU16(uint16_t value) {
     emitByte(value & 0xff);
 }
 
+// Indexes past one byte are written as OP_WIDE, the instruction and a two byte operand.
+static void emitIndexed(uint8_t instruction, int index) {
+    if (index > UINT8_MAX) {
+        emitBytes(OP_WIDE, instruction);
+        emitU16((uint16_t)index);
+    }
+    else {
+        emitBytes(instruction, (uint8_t)index);
+    }
+}
+
 static void emitLoop(int loopStart) {
     emitByte(OP_LOOP);
 
@@ -181,18 +200,72 @@ static void emitReturn() {
     emitByte(OP_RETURN);
 }
 
-static uint8_t makeConstant(Value value) {
-    int constant = addConstant(currentChunk(), value);
-    if (constant > UINT8_MAX) {
+static void indexConstant(int* slots, int capacity, ValueArray* constants, int constant) {
+    uint32_t index = hashValue(constants->values[constant]) & (capacity - 1);
+    while (slots[index] != UNINITIALIZED) {
+        index = (index + 1) & (capacity - 1);
+    }
+    slots[index] = constant;
+}
+
+static void growConstantSlots(Compiler* compiler) {
+    ValueArray* constants = &compiler->function->chunk.constants;
+    int capacity = GROW_CAPACITY(compiler->constantCapacity);
+    int* slots = ALLOCATE(int, capacity);
+    for (int i = 0; i < capacity; i++) {
+        slots[i] = UNINITIALIZED;
+    }
+
+    for (int i = 0; i < constants->count; i++) {
+        indexConstant(slots, capacity, constants, i);
+    }
+
+    FREE_ARRAY(int, compiler->constantSlots, compiler->constantCapacity);
+    compiler->constantSlots = slots;
+    compiler->constantCapacity = capacity;
+}
+
+// Returns the slot of an identical constant already in the chunk, adding the
+// value only when there is none.
+static int addUniqueConstant(Compiler* compiler, Value value) {
+    ValueArray* constants = &compiler->function->chunk.constants;
+    int capacity = compiler->constantCapacity;
+
+    if (capacity > 0) {
+        uint32_t index = hashValue(value) & (capacity - 1);
+        for (;;) {
+            int slot = compiler->constantSlots[index];
+            if (slot == UNINITIALIZED) break;
+            if (valuesIdentical(constants->values[slot], value)) return slot;
+
+            index = (index + 1) & (capacity - 1);
+        }
+    }
+
+    // The value is only reachable from the chunk once added, so the index
+    // grows afterwards in case growing it starts a collection.
+    int constant = addConstant(&compiler->function->chunk, value);
+    if (constants->count > compiler->constantCapacity * CONSTANT_MAX_LOAD) {
+        growConstantSlots(compiler);
+    }
+    else {
+        indexConstant(compiler->constantSlots, compiler->constantCapacity, constants, constant);
+    }
+    return constant;
+}
+
+static int makeConstant(Value value) {
+    int constant = addUniqueConstant(current, value);
+    if (constant > UINT16_MAX) {
         error("Too many constants in one chunk.");
         return 0;
     }
 
-    return (uint8_t)constant;
+    return constant;
 }
 
 static void emitConstant(Value value) {
-    emitBytes(OP_CONSTANT, makeConstant(value));
+    emitIndexed(OP_CONSTANT, makeConstant(value));
 }
 
 static void patchJump(int offset) {
@@ -206,19 +279,36 @@ static void patchJump(int offset) {
     currentChunk()->code[offset + 1] = jump & 0xff;
 }
 
+static Local* pushLocal(Compiler* compiler) {
+    if (compiler->localCapacity < compiler->localCount + 1) {
+        int oldCapacity = compiler->localCapacity;
+        compiler->localCapacity = GROW_CAPACITY(oldCapacity);
+        compiler->locals = GROW_ARRAY(Local, compiler->locals, oldCapacity, compiler->localCapacity);
+    }
+
+    return &compiler->locals[compiler->localCount++];
+}
+
 static void initCompiler(Compiler* compiler, FunctionType type) {
     compiler->enclosing = current;
     compiler->function = NULL;
     compiler->type = type;
+    compiler->locals = NULL;
     compiler->localCount = 0;
+    compiler->localCapacity = 0;
+    compiler->upValues = NULL;
+    compiler->upValueCapacity = 0;
+    compiler->constantSlots = NULL;
+    compiler->constantCapacity = 0;
     compiler->scopeDepth = 0;
+    compiler->lastCall = UNINITIALIZED;
     compiler->function = newFunction();
     current = compiler;
     if (type != TYPE_SCRIPT) {
         current->function->name = copyString(parser.previous.start, parser.previous.length);
     }
 
-    Local* local = &current->locals[current->localCount++];
+    Local* local = pushLocal(current);
     local->depth = 0;
     local->isCaptured = false;
     if (type != TYPE_FUNCTION) {
@@ -231,9 +321,161 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
     }
 }
 
+static void freeCompiler(Compiler* compiler) {
+    FREE_ARRAY(Local, compiler->locals, compiler->localCapacity);
+    FREE_ARRAY(UpValue, compiler->upValues, compiler->upValueCapacity);
+    FREE_ARRAY(int, compiler->constantSlots, compiler->constantCapacity);
+}
+
+static int stackEffect(Chunk* chunk, int offset) {
+    // Under OP_WIDE the index operand that precedes an argument count is two bytes.
+    int indexSize = 1;
+    if (chunk->code[offset] == OP_WIDE) {
+        offset++;
+        indexSize = 2;
+    }
+
+    switch (chunk->code[offset])
+    {
+    case OP_CONSTANT:
+    case OP_NIL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_GET_LOCAL:
+    case OP_GET_GLOBAL:
+    case OP_GET_UPVALUE:
+    case OP_CLOSURE:
+    case OP_CLASS:
+        return 1;
+    case OP_POP:
+    case OP_DEFINE_GLOBAL:
+    case OP_SET_PROPERTY:
+    case OP_GET_SUPER:
+    case OP_EQUAL:
+    case OP_GREATER:
+    case OP_LESS:
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_PRINT:
+    case OP_CLOSE_UPVALUE:
+    case OP_RETURN:
+    case OP_INHERIT:
+    case OP_METHOD:
+        return -1;
+    case OP_CALL:
+    case OP_TAIL_CALL:
+        return -chunk->code[offset + 1];
+    case OP_INVOKE:
+        return -chunk->code[offset + 1 + indexSize];
+    case OP_SUPER_INVOKE:
+        return -chunk->code[offset + 1 + indexSize] - 1;
+    default:
+        return 0;
+    }
+}
+
+static int wideInstructionLength(Chunk* chunk, int offset) {
+    switch (chunk->code[offset + 1])
+    {
+    case OP_INVOKE:
+    case OP_SUPER_INVOKE:
+        return 5;
+    case OP_CLOSURE: {
+        int constant = (chunk->code[offset + 2] << 8) | chunk->code[offset + 3];
+        ObjectFunction* function = AS_FUNCTION(chunk->constants.values[constant]);
+        return 4 + function->upValueCount * 3;
+    }
+    default:
+        return 4;
+    }
+}
+
+static int instructionLength(Chunk* chunk, int offset) {
+    switch (chunk->code[offset])
+    {
+    case OP_NIL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_POP:
+    case OP_EQUAL:
+    case OP_GREATER:
+    case OP_LESS:
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_NOT:
+    case OP_NEGATE:
+    case OP_PRINT:
+    case OP_CLOSE_UPVALUE:
+    case OP_RETURN:
+    case OP_INHERIT:
+        return 1;
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_LOOP:
+    case OP_INVOKE:
+    case OP_SUPER_INVOKE:
+        return 3;
+    case OP_CLOSURE: {
+        ObjectFunction* function = AS_FUNCTION(chunk->constants.values[chunk->code[offset + 1]]);
+        return 2 + function->upValueCount * 2;
+    }
+    case OP_WIDE:
+        return wideInstructionLength(chunk, offset);
+    default:
+        return 2;
+    }
+}
+
+// Walks the finished chunk once, following forward jumps, to find the deepest the
+// value stack can get while this function runs. The VM reserves that much on call.
+static int countMaxSlots(ObjectFunction* function) {
+    Chunk* chunk = &function->chunk;
+    int* jumpDepths = ALLOCATE(int, chunk->count + 1);
+    for (int i = 0; i <= chunk->count; i++) {
+        jumpDepths[i] = UNINITIALIZED;
+    }
+
+    int depth = function->arity + 1;
+    int maxSlots = depth;
+    bool fallsThrough = true;
+
+    for (int offset = 0; offset < chunk->count;) {
+        if (!fallsThrough && jumpDepths[offset] != UNINITIALIZED) {
+            depth = jumpDepths[offset];
+        }
+        else if (fallsThrough && jumpDepths[offset] > depth) {
+            depth = jumpDepths[offset];
+        }
+
+        uint8_t instruction = chunk->code[offset];
+        int length = instructionLength(chunk, offset);
+
+        if (instruction == OP_JUMP || instruction == OP_JUMP_IF_FALSE) {
+            int target = offset + 3 + ((chunk->code[offset + 1] << 8) | chunk->code[offset + 2]);
+            if (jumpDepths[target] < depth) jumpDepths[target] = depth;
+        }
+
+        depth += stackEffect(chunk, offset);
+        if (depth > maxSlots) maxSlots = depth;
+
+        fallsThrough = instruction != OP_JUMP && instruction != OP_LOOP && instruction != OP_RETURN;
+        offset += length;
+    }
+
+    FREE_ARRAY(int, jumpDepths, chunk->count + 1);
+    return maxSlots;
+}
+
 static ObjectFunction* endCompiler() {
     emitReturn();
     ObjectFunction* function = current->function;
+    if (!parser.hadError) {
+        function->maxSlots = countMaxSlots(function);
+    }
 
 #ifdef DEBUG_PRINT_CODE
     if (!parser.hadError) {
@@ -270,7 +512,7 @@ static void statement();
 static ParseRule* getRule(TokenType type);
 static void parsePrecedence(Precedence precedence);
 
-static uint8_t identifierConstant(Token* name) {
+static int identifierConstant(Token* name) {
     return makeConstant(OBJECT_VALUE(copyString(name->start, name->length)));
 }
 
@@ -293,7 +535,7 @@ static int resolveLocal(Compiler* compiler, Token* name) {
     return -1;
 }
 
-static int addUpValue(Compiler* compiler, uint8_t index, bool isLocal) {
+static int addUpValue(Compiler* compiler, int index, bool isLocal) {
     int upValueCount = compiler->function->upValueCount;
 
     for (int i = 0; i < upValueCount; i++) {
@@ -303,13 +545,19 @@ static int addUpValue(Compiler* compiler, uint8_t index, bool isLocal) {
         }
     }
 
-    if (upValueCount == UINT8_COUNT) {
+    if (upValueCount == UINT16_COUNT) {
         error("Too many closure variables in function.");
         return 0;
     }
 
+    if (compiler->upValueCapacity < upValueCount + 1) {
+        int oldCapacity = compiler->upValueCapacity;
+        compiler->upValueCapacity = GROW_CAPACITY(oldCapacity);
+        compiler->upValues = GROW_ARRAY(UpValue, compiler->upValues, oldCapacity, compiler->upValueCapacity);
+    }
+
     compiler->upValues[upValueCount].isLocal = isLocal;
-    compiler->upValues[upValueCount].index = index;
+    compiler->upValues[upValueCount].index = (uint16_t)index;
     return compiler->function->upValueCount++;
 }
 
@@ -319,24 +567,24 @@ static int resolveUpValue(Compiler* compiler, Token* name) {
     int local = resolveLocal(compiler->enclosing, name);
     if (local != -1) {
         compiler->enclosing->locals[local].isCaptured = true;
-        return addUpValue(compiler, (uint8_t)local, true);
+        return addUpValue(compiler, local, true);
     }
 
     int upValue = resolveUpValue(compiler->enclosing, name);
     if (upValue != -1) {
-        return addUpValue(compiler, (uint8_t)upValue, false);
+        return addUpValue(compiler, upValue, false);
     }
 
     return -1;
 }
 
 static void addLocal(Token name) {
-    if (current->localCount == UINT8_COUNT) {
+    if (current->localCount == UINT16_COUNT) {
         error("Too many local variables in function.");
         return;
     }
 
-    Local* local = &current->locals[current->localCount++];
+    Local* local = pushLocal(current);
     local->name = name;
     local->depth = UNINITIALIZED;
     local->isCaptured = false;
@@ -359,7 +607,7 @@ static void declareVariable() {
     addLocal(*name);
 }
 
-static uint8_t parseVariable(const char* errorMessage) {
+static int parseVariable(const char* errorMessage) {
     consume(TOKEN_IDENTIFIER, errorMessage);
 
     declareVariable();
@@ -373,13 +621,13 @@ static void markInitialized() {
     current->locals[current->localCount - 1].depth = current->scopeDepth;
 }
 
-static void defineVariable(uint8_t global) {
+static void defineVariable(int global) {
     if (current->scopeDepth > 0) {
         markInitialized();
         return;
     }
 
-    emitBytes(OP_DEFINE_GLOBAL, global);
+    emitIndexed(OP_DEFINE_GLOBAL, global);
 }
 
 static uint8_t argumentList() {
@@ -428,24 +676,25 @@ static void binary(bool canAssign) {
 
 static void call(bool canAssign) {
     uint8_t argCount = argumentList();
+    current->lastCall = currentChunk()->count;
     emitBytes(OP_CALL, argCount);
 }
 
 static void dot(bool canAssign) {
     consume(TOKEN_IDENTIFIER, "Expect property name after '.'.");
-    uint8_t name = identifierConstant(&parser.previous);
+    int name = identifierConstant(&parser.previous);
 
     if (canAssign && match(TOKEN_EQUAL)) {
         expression();
-        emitBytes(OP_SET_PROPERTY, name);
+        emitIndexed(OP_SET_PROPERTY, name);
     }
     else if (match(TOKEN_LEFT_PAREN)) {
         uint8_t argCount = argumentList();
-        emitBytes(OP_INVOKE, name);
+        emitIndexed(OP_INVOKE, name);
         emitByte(argCount);
     }
     else {
-        emitBytes(OP_GET_PROPERTY, name);
+        emitIndexed(OP_GET_PROPERTY, name);
     }
 }
 
@@ -504,10 +753,10 @@ static void namedVariable(Token name, bool canAssign) {
 
     if (canAssign && match(TOKEN_EQUAL)) {
         expression();
-        emitBytes(setOp, (uint8_t)arg);
+        emitIndexed(setOp, arg);
     }
     else {
-        emitBytes(getOp, (uint8_t)arg);
+        emitIndexed(getOp, arg);
     }
 }
 
@@ -534,18 +783,18 @@ static void loxSuper(bool canAssign) {
 
     consume(TOKEN_DOT, "Expect '.' after 'super'.");
     consume(TOKEN_IDENTIFIER, "Expect  superclass method name.");
-    uint8_t name = identifierConstant(&parser.previous);
+    int name = identifierConstant(&parser.previous);
 
     namedVariable(syntheticToken("this"), false);
     if (match(TOKEN_LEFT_PAREN)) {
         uint8_t argCount = argumentList();
         namedVariable(syntheticToken("super"), false);
-        emitBytes(OP_SUPER_INVOKE, name);
+        emitIndexed(OP_SUPER_INVOKE, name);
         emitByte(argCount);
     }
     else {
         namedVariable(syntheticToken("super"), false);
-        emitBytes(OP_GET_SUPER, name);
+        emitIndexed(OP_GET_SUPER, name);
     }
 }
 
@@ -663,7 +912,7 @@ static void function(FunctionType type) {
             if (current->function->arity > MAX_ARGS) {
                 errorAtCurrent("Can't have more than 255 parameters");
             }
-            uint8_t constant = parseVariable("Expect parameter name.");
+            int constant = parseVariable("Expect parameter name.");
             defineVariable(constant);
         } while (match(TOKEN_COMMA));
     }
@@ -672,17 +921,38 @@ static void function(FunctionType type) {
     block();
 
     ObjectFunction* function = endCompiler();
-    emitBytes(OP_CLOSURE, makeConstant(OBJECT_VALUE(function)));
+    int constant = makeConstant(OBJECT_VALUE(function));
+
+    // A wide closure widens its constant and every captured index together.
+    bool wide = constant > UINT8_MAX;
+    for (int i = 0; i < function->upValueCount; i++) {
+        if (compiler.upValues[i].index > UINT8_MAX) wide = true;
+    }
+
+    if (wide) {
+        emitBytes(OP_WIDE, OP_CLOSURE);
+        emitU16((uint16_t)constant);
+    }
+    else {
+        emitBytes(OP_CLOSURE, (uint8_t)constant);
+    }
 
     for (int i = 0; i < function->upValueCount; i++) {
         emitByte(compiler.upValues[i].isLocal ? 1 : 0);
-        emitByte(compiler.upValues[i].index);
+        if (wide) {
+            emitU16(compiler.upValues[i].index);
+        }
+        else {
+            emitByte((uint8_t)compiler.upValues[i].index);
+        }
     }
+
+    freeCompiler(&compiler);
 }
 
 static void method() {
     consume(TOKEN_IDENTIFIER, "Expect method name.");
-    uint8_t constant = identifierConstant(&parser.previous);
+    int constant = identifierConstant(&parser.previous);
 
     FunctionType type = TYPE_METHOD;
     if (parser.previous.length == 4 && memcmp(parser.previous.start, "init", 4) == 0) {
@@ -690,16 +960,16 @@ static void method() {
     }
 
     function(type);
-    emitBytes(OP_METHOD, constant);
+    emitIndexed(OP_METHOD, constant);
 }
 
 static void classDeclaration() {
     consume(TOKEN_IDENTIFIER, "Expect class name.");
     Token className = parser.previous;
-    uint8_t nameConstant = identifierConstant(&parser.previous);
+    int nameConstant = identifierConstant(&parser.previous);
     declareVariable();
 
-    emitBytes(OP_CLASS, nameConstant);
+    emitIndexed(OP_CLASS, nameConstant);
     defineVariable(nameConstant);
 
     ClassCompiler classCompiler = {
@@ -741,14 +1011,14 @@ static void classDeclaration() {
 }
 
 static void funDeclaration() {
-    uint8_t global = parseVariable("Expect function name.");
+    int global = parseVariable("Expect function name.");
     markInitialized();
     function(TYPE_FUNCTION);
     defineVariable(global);
 }
 
 static void varDeclaration() {
-    uint8_t global = parseVariable("Expect a variable name.");
+    int global = parseVariable("Expect a variable name.");
 
     if (match(TOKEN_EQUAL)) {
         expression();
@@ -851,6 +1121,12 @@ static void returnStatement() {
 
         expression();
         consume(TOKEN_SEMICOLON, "Expect ';' after return value.");
+
+        // A call that is the last instruction of the return value can reuse this frame.
+        // OP_RETURN is still emitted for paths that jump past it (e.g. 'return a or f();').
+        if (current->lastCall != UNINITIALIZED && current->lastCall == currentChunk()->count - 2) {
+            currentChunk()->code[current->lastCall] = OP_TAIL_CALL;
+        }
         emitByte(OP_RETURN);
     }
 }
@@ -952,6 +1228,7 @@ ObjectFunction* compile(const char* source) {
     }
 
     ObjectFunction* function = endCompiler();
+    freeCompiler(&compiler);
     return parser.hadError ? NULL : function;
 }
 
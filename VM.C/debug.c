@@ -17,10 +17,16 @@ static int simpleInstruction(const char* name, int offset) {
 	return offset + 1;
 }
 
-static int byteInstruction(const char* name, Chunk* chunk, int offset) {
-	uint8_t slot = chunk->code[offset + 1];
+// Reads the index operand at offset, two bytes wide after an OP_WIDE prefix.
+static int readIndex(Chunk* chunk, int offset, bool wide) {
+	if (wide) return (chunk->code[offset] << 8) | chunk->code[offset + 1];
+	return chunk->code[offset];
+}
+
+static int byteInstruction(const char* name, Chunk* chunk, int offset, bool wide) {
+	int slot = readIndex(chunk, offset + 1, wide);
 	printf("%-16s %4d\n", name, slot);
-	return offset + 2;
+	return offset + (wide ? 3 : 2);
 }
 
 static int jumpInstruction(const char* name, int sign, Chunk* chunk, int offset) {
@@ -29,38 +35,46 @@ static int jumpInstruction(const char* name, int sign, Chunk* chunk, int offset)
 	return offset + 3;
 }
 
-static int constantInstruction(const char* name, Chunk* chunk, int offset) {
-	uint8_t constant = chunk->code[offset + 1];
+static int constantInstruction(const char* name, Chunk* chunk, int offset, bool wide) {
+	int constant = readIndex(chunk, offset + 1, wide);
 	printf("%-16s %4d '", name, constant);
 	printValue(chunk->constants.values[constant]);
 	printf("'\n");
-	return offset + 2;
+	return offset + (wide ? 3 : 2);
 }
 
-static int invokeInstruction(const char* name, Chunk* chunk, int offset) {
-	uint8_t constant = chunk->code[offset + 1];
-	uint8_t argCount = chunk->code[offset + 2];
+static int invokeInstruction(const char* name, Chunk* chunk, int offset, bool wide) {
+	int constant = readIndex(chunk, offset + 1, wide);
+	offset += wide ? 3 : 2;
+	uint8_t argCount = chunk->code[offset];
 	printf("%-16s (%d args) %4d '", name, argCount, constant);
 	printValue(chunk->constants.values[constant]);
 	printf("'\n");
-	return offset + 3;
+	return offset + 1;
 }
 
 int disassembleInstruction(Chunk* chunk, int offset) {
 	printf("%04d ", offset);
 
-	if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1]) {
+	int line = getLine(chunk, offset);
+	if (offset > 0 && line == getLine(chunk, offset - 1)) {
 		printf("   | ");
 	}
 	else {
-		printf("%4d ", chunk->lines[offset]);
+		printf("%4d ", line);
 	}
 
 	uint8_t instruction = chunk->code[offset];
+	bool wide = instruction == OP_WIDE;
+	if (wide) {
+		printf("OP_WIDE ");
+		instruction = chunk->code[++offset];
+	}
+
 	switch (instruction)
 	{
 	case OP_CONSTANT:
-		return constantInstruction("OP_CONSTANT", chunk, offset);
+		return constantInstruction("OP_CONSTANT", chunk, offset, wide);
 	case OP_NIL:
 		return simpleInstruction("OP_NIL", offset);
 	case OP_TRUE:
@@ -70,25 +84,25 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 	case OP_POP:
 		return simpleInstruction("OP_POP", offset);
 	case OP_GET_LOCAL:
-		return byteInstruction("OP_GET_LOCAL", chunk, offset);
+		return byteInstruction("OP_GET_LOCAL", chunk, offset, wide);
 	case OP_SET_LOCAL:
-		return byteInstruction("OP_SET_LOCAL", chunk, offset);
+		return byteInstruction("OP_SET_LOCAL", chunk, offset, wide);
 	case OP_GET_GLOBAL:
-		return constantInstruction("OP_GET_GLOBAL", chunk, offset);
+		return constantInstruction("OP_GET_GLOBAL", chunk, offset, wide);
 	case OP_GET_UPVALUE:
-		return byteInstruction("OP_GET_UPVALUE", chunk, offset);
+		return byteInstruction("OP_GET_UPVALUE", chunk, offset, wide);
 	case OP_SET_UPVALUE:
-		return byteInstruction("OP_SET_UPVALUE", chunk, offset);
+		return byteInstruction("OP_SET_UPVALUE", chunk, offset, wide);
 	case OP_DEFINE_GLOBAL:
-		return constantInstruction("OP_DEFINE_GLOBAL", chunk, offset);
+		return constantInstruction("OP_DEFINE_GLOBAL", chunk, offset, wide);
 	case OP_SET_GLOBAL:
-		return constantInstruction("OP_SET_GLOBAL", chunk, offset);
+		return constantInstruction("OP_SET_GLOBAL", chunk, offset, wide);
 	case OP_GET_PROPERTY:
-		return constantInstruction("OP_GET_PROPERTY", chunk, offset);
+		return constantInstruction("OP_GET_PROPERTY", chunk, offset, wide);
 	case OP_SET_PROPERTY:
-		return constantInstruction("OP_SET_PROPERTY", chunk, offset);
+		return constantInstruction("OP_SET_PROPERTY", chunk, offset, wide);
 	case OP_GET_SUPER:
-		return constantInstruction("OP_GET_SUPER", chunk, offset);
+		return constantInstruction("OP_GET_SUPER", chunk, offset, wide);
 	case OP_EQUAL:
 		return simpleInstruction("OP_EQUAL", offset);
 	case OP_GREATER:
@@ -116,14 +130,16 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 	case OP_LOOP:
 		return jumpInstruction("OP_LOOP", -1, chunk, offset);
 	case OP_CALL:
-		return byteInstruction("OP_CALL", chunk, offset);
+		return byteInstruction("OP_CALL", chunk, offset, false);
+	case OP_TAIL_CALL:
+		return byteInstruction("OP_TAIL_CALL", chunk, offset, false);
 	case OP_INVOKE: 
-		return invokeInstruction("OP_INVOKE", chunk, offset);
+		return invokeInstruction("OP_INVOKE", chunk, offset, wide);
 	case OP_SUPER_INVOKE:
-		return invokeInstruction("OP_SUPER_INVOKE", chunk, offset);
+		return invokeInstruction("OP_SUPER_INVOKE", chunk, offset, wide);
 	case OP_CLOSURE: {
-		offset++;
-		uint8_t constant = chunk->code[offset++];
+		int constant = readIndex(chunk, offset + 1, wide);
+		offset += wide ? 3 : 2;
 		printf("%-16s %4d ", "OP_CLOSURE", constant);
 		printValue(chunk->constants.values[constant]);
 		printf("\n");
@@ -131,9 +147,10 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 		ObjectFunction* function = AS_FUNCTION(chunk->constants.values[constant]);
 		for (int i = 0; i < function->upValueCount; i++) {
 			int isLocal = chunk->code[offset++];
-			int index = chunk->code[offset++];
+			int index = readIndex(chunk, offset, wide);
+			offset += wide ? 2 : 1;
 			printf("%04d      |                     %s %d\n",
-				offset - 2, isLocal ? "local" : "upValue", index);
+				offset - (wide ? 3 : 2), isLocal ? "local" : "upValue", index);
 		}
 
 		return offset;
@@ -143,11 +160,11 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 	case OP_RETURN:
 		return simpleInstruction("OP_RETURN", offset);
 	case OP_CLASS:
-		return constantInstruction("OP_CLASS", chunk, offset);
+		return constantInstruction("OP_CLASS", chunk, offset, wide);
 	case OP_INHERIT:
 		return simpleInstruction("OP_INHERIT", offset);
 	case OP_METHOD:
-		return constantInstruction("OP_METHOD", chunk, offset);
+		return constantInstruction("OP_METHOD", chunk, offset, wide);
 	default:
 		printf("Unknown opcode %d\n", instruction);
 		return offset + 1;
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "file.h"
+
+static char* tempPathFor(const char* path, const char* suffix) {
+    size_t length = strlen(path);
+    size_t suffixLength = strlen(suffix);
+    char* tempPath = (char*)malloc(length + suffixLength + 1);
+    if (tempPath == NULL) return NULL;
+
+    memcpy(tempPath, path, length);
+    memcpy(tempPath + length, suffix, suffixLength + 1);
+    return tempPath;
+}
+
+#ifdef _WIN32
+
+bool mapFile(const char* path, MappedFile* file) {
+    file->data = NULL;
+    file->size = 0;
+    file->mappedSize = 0;
+
+    FILE* stream = openFile(path, "rb");
+    if (stream == NULL) return false;
+
+    fseek(stream, 0L, SEEK_END);
+    size_t fileSize = ftell(stream);
+    rewind(stream);
+
+    char* buffer = (char*)malloc(fileSize + 1);
+    if (buffer == NULL || fread(buffer, sizeof(char), fileSize, stream) < fileSize) {
+        free(buffer);
+        fclose(stream);
+        return false;
+    }
+    buffer[fileSize] = '\0';
+    fclose(stream);
+
+    file->data = buffer;
+    file->size = fileSize;
+    return true;
+}
+
+void unmapFile(MappedFile* file) {
+    free((void*)file->data);
+    file->data = NULL;
+    file->size = 0;
+}
+
+FILE* openFile(const char* path, const char* mode) {
+    FILE* file;
+    if (fopen_s(&file, path, mode)) return NULL;
+    return file;
+}
+
+bool openReplacement(const char* path, ReplacementFile* file) {
+    file->path = path;
+    file->tempPath = tempPathFor(path, ".tmp");
+    file->stream = file->tempPath == NULL ? NULL : openFile(file->tempPath, "wb");
+    if (file->stream != NULL) return true;
+
+    free(file->tempPath);
+    file->tempPath = NULL;
+    return false;
+}
+
+// rename() will not replace an existing file here. mapFile reads the whole file
+// into memory on Windows, so removing path first cannot pull it from under anyone.
+static bool replace(const char* tempPath, const char* path) {
+    remove(path);
+    return rename(tempPath, path) == 0;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool mapFile(const char* path, MappedFile* file) {
+    file->data = NULL;
+    file->size = 0;
+    file->mappedSize = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // Reserve one byte past the end so the view is always '\0' terminated: the file is
+    // mapped over the start of an anonymous zero-filled region.
+    size_t size = (size_t)info.st_size;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mappedSize = (size + 1 + pageSize - 1) / pageSize * pageSize;
+
+    char* base = (char*)mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    if (size > 0 && mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, mappedSize);
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    file->data = base;
+    file->size = size;
+    file->mappedSize = mappedSize;
+    return true;
+}
+
+void unmapFile(MappedFile* file) {
+    if (file->data != NULL) {
+        munmap((void*)file->data, file->mappedSize);
+    }
+    file->data = NULL;
+    file->size = 0;
+    file->mappedSize = 0;
+}
+
+FILE* openFile(const char* path, const char* mode) {
+    return fopen(path, mode);
+}
+
+bool openReplacement(const char* path, ReplacementFile* file) {
+    file->path = path;
+    file->stream = NULL;
+    file->tempPath = tempPathFor(path, ".XXXXXX");
+    if (file->tempPath == NULL) return false;
+
+    int fd = mkstemp(file->tempPath);
+    if (fd >= 0) {
+        // mkstemp creates the file readable only by its owner; give it the
+        // permissions a plain fopen would have.
+        mode_t mask = umask(0);
+        umask(mask);
+        fchmod(fd, 0666 & ~mask);
+
+        file->stream = fdopen(fd, "wb");
+        if (file->stream != NULL) return true;
+
+        close(fd);
+        unlink(file->tempPath);
+    }
+
+    free(file->tempPath);
+    file->tempPath = NULL;
+    return false;
+}
+
+// rename() swaps the directory entry atomically: processes that mapped the old
+// file keep its pages, and new ones see only the complete new file.
+static bool replace(const char* tempPath, const char* path) {
+    return rename(tempPath, path) == 0;
+}
+
+#endif // _WIN32
+
+bool commitReplacement(ReplacementFile* file) {
+    bool written = !ferror(file->stream);
+    if (fclose(file->stream) != 0) written = false;
+    if (written) written = replace(file->tempPath, file->path);
+    if (!written) remove(file->tempPath);
+
+    free(file->tempPath);
+    file->stream = NULL;
+    file->tempPath = NULL;
+    return written;
+}
@@ -0,0 +1,31 @@
+#ifndef clox_file_h
+#define clox_file_h
+
+#include <stdio.h>
+
+#include "common.h"
+
+typedef struct MappedFile {
+    const char* data;
+    size_t size;
+    size_t mappedSize;
+} MappedFile;
+
+bool mapFile(const char* path, MappedFile* file);
+void unmapFile(MappedFile* file);
+FILE* openFile(const char* path, const char* mode);
+
+// A file written beside path under a temporary name and renamed over it when
+// committed, so a process that has path mapped never sees it truncated.
+typedef struct ReplacementFile {
+    FILE* stream;
+    const char* path;
+    char* tempPath;
+} ReplacementFile;
+
+bool openReplacement(const char* path, ReplacementFile* file);
+// Renames the file over path if it was written without errors, otherwise
+// removes it. Returns whether path was replaced.
+bool commitReplacement(ReplacementFile* file);
+
+#endif // !clox_file_h
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "file.h"
+#include "heapprofile.h"
+#include "memory.h"
+#include "vm.h"
+
+typedef struct AllocationSite {
+    ObjectFunction* function;
+    int line;
+    int type;
+    size_t bytes;
+    size_t count;
+} AllocationSite;
+
+typedef struct Collection {
+    size_t before;
+    size_t after;
+    size_t objects;
+} Collection;
+
+bool heapProfiling = false;
+int allocationType = ALLOCATION_MEMORY;
+
+static FILE* output = NULL;
+
+// Sites are kept in their own open-addressed table allocated with malloc so
+// recording never feeds back into the allocation counts or triggers a GC.
+static AllocationSite* sites = NULL;
+static int siteCount = 0;
+static int siteCapacity = 0;
+
+static Collection* collections = NULL;
+static int collectionCount = 0;
+static int collectionCapacity = 0;
+
+static uint32_t hashSite(ObjectFunction* function, int line, int type) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (uint32_t)((uintptr_t)function >> 4)) * 16777619u;
+    hash = (hash ^ (uint32_t)line) * 16777619u;
+    hash = (hash ^ (uint32_t)type) * 16777619u;
+    return hash;
+}
+
+static AllocationSite* findSite(AllocationSite* entries, int capacity, ObjectFunction* function, int line, int type) {
+    uint32_t index = hashSite(function, line, type) & (capacity - 1);
+
+    for (;;) {
+        AllocationSite* site = &entries[index];
+        if (site->count == 0 ||
+            (site->function == function && site->line == line && site->type == type)) {
+            return site;
+        }
+        index = (index + 1) & (capacity - 1);
+    }
+}
+
+static bool growSites() {
+    int capacity = GROW_CAPACITY(siteCapacity) * 2;
+    AllocationSite* entries = (AllocationSite*)calloc(capacity, sizeof(AllocationSite));
+    if (entries == NULL) return false;
+
+    for (int i = 0; i < siteCapacity; i++) {
+        AllocationSite* site = &sites[i];
+        if (site->count == 0) continue;
+        *findSite(entries, capacity, site->function, site->line, site->type) = *site;
+    }
+
+    free(sites);
+    sites = entries;
+    siteCapacity = capacity;
+    return true;
+}
+
+bool startHeapProfile(const char* path) {
+    output = openFile(path, "w");
+    if (output == NULL) return false;
+
+    heapProfiling = true;
+    // Writes the report even when the script ends in exit().
+    atexit(stopHeapProfile);
+    return true;
+}
+
+// Attributes size bytes to the line the innermost call frame is executing.
+// Allocations made while compiling or loading images have no frame.
+void recordAllocation(size_t size) {
+    if (siteCount + 1 > siteCapacity * 3 / 4 && !growSites()) return;
+
+    ObjectFunction* function = NULL;
+    int line = 0;
+
+    if (vm.frameCount > 0) {
+        CallFrame* frame = &vm.frames[vm.frameCount - 1];
+        function = frame->closure->function;
+        ptrdiff_t offset = frame->ip - function->chunk.code - 1;
+        if (offset >= 0 && offset < function->chunk.count) line = getLine(&function->chunk, (int)offset);
+    }
+
+    AllocationSite* site = findSite(sites, siteCapacity, function, line, allocationType);
+    if (site->count == 0) {
+        site->function = function;
+        site->line = line;
+        site->type = allocationType;
+        siteCount++;
+    }
+
+    site->bytes += size;
+    site->count++;
+}
+
+void recordCollection(size_t before, size_t after) {
+    if (collectionCount + 1 > collectionCapacity) {
+        int capacity = GROW_CAPACITY(collectionCapacity);
+        Collection* grown = (Collection*)realloc(collections, sizeof(Collection) * capacity);
+        if (grown == NULL) return;
+        collections = grown;
+        collectionCapacity = capacity;
+    }
+
+    size_t objects = 0;
+    for (Object* object = vm.objects; object != NULL; object = object->next) {
+        objects++;
+    }
+
+    Collection* collection = &collections[collectionCount++];
+    collection->before = before;
+    collection->after = after;
+    collection->objects = objects;
+}
+
+static const char* typeName(int type) {
+    switch (type)
+    {
+    case OBJECT_BOUND_METHOD:   return "bound method";
+    case OBJECT_CLASS:          return "class";
+    case OBJECT_CLOSURE:        return "closure";
+    case OBJECT_FUNCTION:       return "function";
+    case OBJECT_INSTANCE:       return "instance";
+    case OBJECT_NATIVE:         return "native";
+    case OBJECT_STRING:         return "string";
+    case OBJECT_UPVALUE:        return "upvalue";
+    default:                    return "memory";
+    }
+}
+
+static int compareBytes(const void* a, const void* b) {
+    size_t left = (*(const AllocationSite**)a)->bytes;
+    size_t right = (*(const AllocationSite**)b)->bytes;
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+static int compareCounts(const void* a, const void* b) {
+    size_t left = (*(const AllocationSite**)a)->count;
+    size_t right = (*(const AllocationSite**)b)->count;
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+static void writeSites(const char* title, AllocationSite** sorted, int count) {
+    fprintf(output, "%s\n", title);
+    fprintf(output, "%14s %12s  %-13s %s\n", "bytes", "count", "type", "site");
+
+    for (int i = 0; i < count && i < HEAP_PROFILE_TOP_SITES; i++) {
+        AllocationSite* site = sorted[i];
+        fprintf(output, "%14zu %12zu  %-13s ", site->bytes, site->count, typeName(site->type));
+
+        if (site->function == NULL) {
+            fprintf(output, "(vm)\n");
+        }
+        else if (site->function->name == NULL) {
+            fprintf(output, "script:%d\n", site->line);
+        }
+        else {
+            fprintf(output, "%.*s:%d\n", site->function->name->length, site->function->name->chars, site->line);
+        }
+    }
+    fprintf(output, "\n");
+}
+
+static void writeCollections() {
+    fprintf(output, "Collections\n");
+    fprintf(output, "%6s %14s %14s %12s\n", "gc", "before", "surviving", "objects");
+
+    for (int i = 0; i < collectionCount; i++) {
+        Collection* collection = &collections[i];
+        fprintf(output, "%6d %14zu %14zu %12zu\n", i + 1, collection->before, collection->after, collection->objects);
+    }
+}
+
+void stopHeapProfile() {
+    if (output == NULL) return;
+
+    heapProfiling = false;
+
+    AllocationSite** sorted = (AllocationSite**)malloc(sizeof(AllocationSite*) * (siteCount > 0 ? siteCount : 1));
+    int count = 0;
+    for (int i = 0; sorted != NULL && i < siteCapacity; i++) {
+        if (sites[i].count > 0) sorted[count++] = &sites[i];
+    }
+
+    if (count > 0) {
+        qsort(sorted, count, sizeof(AllocationSite*), compareBytes);
+        writeSites("Allocation sites by bytes", sorted, count);
+        qsort(sorted, count, sizeof(AllocationSite*), compareCounts);
+        writeSites("Allocation sites by count", sorted, count);
+    }
+    writeCollections();
+
+    fclose(output);
+    free(sorted);
+    free(sites);
+    free(collections);
+    output = NULL;
+    sites = NULL;
+    siteCount = 0;
+    siteCapacity = 0;
+    collections = NULL;
+    collectionCount = 0;
+    collectionCapacity = 0;
+}
+
+// Functions named in the report stay alive until it is written.
+void markHeapProfileRoots() {
+    for (int i = 0; i < siteCapacity; i++) {
+        if (sites[i].count > 0) markObject((Object*)sites[i].function);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef clox_heapprofile_h
+#define clox_heapprofile_h
+
+#include "common.h"
+
+#define HEAP_PROFILE_TOP_SITES 20
+
+// Allocations made while no object type is set are array, table and string
+// storage rather than objects.
+#define ALLOCATION_MEMORY -1
+
+extern bool heapProfiling;
+extern int allocationType;
+
+bool startHeapProfile(const char* path);
+void stopHeapProfile();
+void recordAllocation(size_t size);
+void recordCollection(size_t before, size_t after);
+void markHeapProfileRoots();
+
+#endif // !clox_heapprofile_h
@@ -1,10 +1,18 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "common.h"
+#include "cache.h"
 #include "chunk.h"
+#include "compiler.h"
 #include "debug.h"
+#include "file.h"
+#include "heapprofile.h"
+#include "perfcounters.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "vm.h"
 
 void repl() {
@@ -17,60 +25,167 @@ void repl() {
 			break;
 		}
 
+		startPerfCounters();
 		interpret(line);
+		stopPerfCounters();
 	}
 }
 
-static char* readFile(const char* path) {
-	FILE* file;
-	if (fopen_s(&file, path, "rb")) {
-		fprintf(stderr, "Could not open file \"%s\".\n", path);
+static MappedFile compiledImage;
+static MappedFile snapshotImage;
+
+static void readFile(const char* path, MappedFile* file) {
+	if (!mapFile(path, file)) {
+		fprintf(stderr, "Could not read file \"%s\".\n", path);
 		exit(74);
 	}
+}
+
+void runFile(const char* path) {
+	MappedFile source;
+	readFile(path, &source);
+	char* compiledPath = cachePath(path);
+
+	ObjectFunction* function = NULL;
+	if (compiledPath != NULL && mapFile(compiledPath, &compiledImage)) {
+		function = loadCache(&compiledImage, path, source.data);
+		if (function == NULL) unmapFile(&compiledImage);
+	}
 
-	fseek(file, 0L, SEEK_END);
-	size_t fileSize = ftell(file);
-	rewind(file);
+	if (function == NULL) {
+		function = compile(source.data);
+		if (function != NULL && compiledPath != NULL) {
+			writeCache(compiledPath, path, source.data, function);
+		}
+	}
+
+	free(compiledPath);
+	unmapFile(&source);
+
+	if (function == NULL) exit(65);
+
+	startPerfCounters();
+	InterpretResult result = interpretFunction(function);
+	stopPerfCounters();
+	if (result == INTERPRET_RUNTIME_ERROR) exit(70);
+}
 
-	char* buffer = (char*)malloc(fileSize + 1);
-	if (buffer == NULL) {
-		fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
+static void restoreSnapshot(const char* path) {
+	if (!mapFile(path, &snapshotImage) || !loadSnapshot(&snapshotImage)) {
+		fprintf(stderr, "Could not load snapshot \"%s\".\n", path);
 		exit(74);
 	}
-	size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
-	if (bytesRead < fileSize) {
-		fprintf(stderr, "Could not read file \"%s\".\n", path);
+}
+
+static void saveSnapshot(const char* path) {
+	if (!writeSnapshot(path)) {
+		fprintf(stderr, "Could not write snapshot \"%s\".\n", path);
 		exit(74);
 	}
-	buffer[bytesRead] = '\0';
+}
 
-	fclose(file);
-	return buffer;
+static void profile(const char* path) {
+	if (!startProfiler(path)) {
+		fprintf(stderr, "Could not start profiler \"%s\".\n", path);
+		exit(74);
+	}
 }
 
-void runFile(const char* path) {
-	char* source = readFile(path);
-	InterpretResult result = interpret(source);
-	free(source);
+static void profileHeap(const char* path) {
+	if (!startHeapProfile(path)) {
+		fprintf(stderr, "Could not start heap profile \"%s\".\n", path);
+		exit(74);
+	}
+}
 
-	if (result == INTERPRET_COMPILE_ERROR) exit(65);
-	if (result == INTERPRET_RUNTIME_ERROR) exit(70);
+static void openCounters() {
+	if (!openPerfCounters()) {
+		fprintf(stderr, "Could not open performance counters.\n");
+		exit(74);
+	}
+}
+
+static void usage() {
+	fprintf(stderr, "Usage: lox [--perf-counters] [--profile output] [--heap-profile output] [--from-snapshot image] [--snapshot image] [--max-frames count] [path]\n");
+	exit(64);
 }
 
 int main(int argc, const char* argv[]) {
+	const char* path = NULL;
+	const char* snapshotPath = NULL;
+	const char* restorePath = NULL;
+	const char* profilePath = NULL;
+	const char* heapProfilePath = NULL;
+	bool perfCounters = false;
+	long maxFrames = FRAMES_MAX;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+			snapshotPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--from-snapshot") == 0 && i + 1 < argc) {
+			restorePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			profilePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--heap-profile") == 0 && i + 1 < argc) {
+			heapProfilePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--max-frames") == 0 && i + 1 < argc) {
+			char* end;
+			maxFrames = strtol(argv[++i], &end, 10);
+			if (*end != '\0' || maxFrames < 1 || maxFrames > INT_MAX) usage();
+		}
+		else if (strcmp(argv[i], "--perf-counters") == 0) {
+			perfCounters = true;
+		}
+		else if (path == NULL && argv[i][0] != '-') {
+			path = argv[i];
+		}
+		else {
+			usage();
+		}
+	}
+
+	if (snapshotPath != NULL && path == NULL) usage();
+
 	initVM();
+	vm.framesMax = (int)maxFrames;
 
-	if (argc == 1) {
-		repl();
+	if (restorePath != NULL) {
+		restoreSnapshot(restorePath);
+	}
+
+	if (profilePath != NULL) {
+		profile(profilePath);
 	}
-	else if (argc == 2) {
-		runFile(argv[1]);
+
+	if (heapProfilePath != NULL) {
+		profileHeap(heapProfilePath);
+	}
+
+	if (perfCounters) {
+		openCounters();
+	}
+
+	if (path == NULL) {
+		repl();
 	}
 	else {
-		fprintf(stderr, "Usage: lox [path]\n");
-		exit(64);
+		runFile(path);
+	}
+
+	stopProfiler();
+	stopHeapProfile();
+	reportPerfCounters();
+
+	if (snapshotPath != NULL) {
+		saveSnapshot(snapshotPath);
 	}
 
 	freeVM();
+	unmapFile(&compiledImage);
+	unmapFile(&snapshotImage);
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,9 @@
 #include <stdlib.h>
 
+#include "heapprofile.h"
 #include "memory.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "vm.h"
 
 #ifdef DEBUG_LOG_GC
@@ -29,6 +32,8 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
         if (vm.bytesAllocated > vm.nextGC) {
             collectGarbage();
         }
+
+        if (heapProfiling) recordAllocation(newSize - oldSize);
     }
 
     if (newSize == 0) {
@@ -78,6 +83,12 @@ static void blackenObject(Object* object) {
 
     switch (object->type)
     {
+    case OBJECT_BOUND_METHOD: {
+        ObjectBoundMethod* boundMethod = (ObjectBoundMethod*)object;
+        markValue(boundMethod->receiver);
+        markObject((Object*)boundMethod->method);
+        break;
+    }
     case OBJECT_CLASS: {
         ObjectClass* loxClass = (ObjectClass*)object;
         markObject((Object*)loxClass->name);
@@ -122,9 +133,7 @@ static void freeObject(Object* object) {
     switch (object->type)
     {
     case OBJECT_BOUND_METHOD: {
-        ObjectBoundMethod* boundMethod = (ObjectBoundMethod*)object;
-        markValue(boundMethod->receiver);
-        markObject((Object*)boundMethod->method);
+        FREE(ObjectBoundMethod, object);
         break;
     }
     case OBJECT_CLASS: {
@@ -136,13 +145,13 @@ static void freeObject(Object* object) {
     case OBJECT_CLOSURE: {
         ObjectClosure* closure = (ObjectClosure*)object;
         FREE_ARRAY(ObjectUpValue*, closure->upValues, closure->upValueCount);
-        FREE(OBJECT_CLOSURE, object);
+        FREE(ObjectClosure, object);
         break;
     }
     case OBJECT_FUNCTION: {
         ObjectFunction* function = (ObjectFunction*)object;
         freeChunk(&function->chunk);
-        FREE(OBJECT_FUNCTION, object);
+        FREE(ObjectFunction, object);
         break;
     }
     case OBJECT_INSTANCE: {
@@ -162,7 +171,7 @@ static void freeObject(Object* object) {
         break;
     }
     case OBJECT_UPVALUE: {
-        FREE(OBJECT_UPVALUE, object);
+        FREE(ObjectUpValue, object);
         break;
     }
     }
@@ -183,6 +192,9 @@ static void markRoots() {
 
     markTable(&vm.globals);
     markCompilerRoots();
+    markSnapshotRoots();
+    markProfilerRoots();
+    markHeapProfileRoots();
     markObject((Object*)vm.initString);
 }
 
@@ -221,9 +233,10 @@ static void sweep() {
 
 void collectGarbage()
 {
+    size_t before = vm.bytesAllocated;
+
 #ifdef DEBUG_LOG_GC
     printf("-- gc begin --\n");
-    size_t before = vm.bytesAllocated;
 #endif
 
     markRoots();
@@ -233,6 +246,8 @@ void collectGarbage()
 
     vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
 
+    if (heapProfiling) recordCollection(before, vm.bytesAllocated);
+
 #ifdef DEBUG_LOG_GC
     printf("-- gc end --\n");
     printf("   collected %zu bytes (from %zu to %zu) next at %zu\n",
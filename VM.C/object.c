@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "heapprofile.h"
 #include "memory.h"
 #include "object.h"
 #include "table.h"
@@ -11,7 +12,9 @@
     (type*)allocateObject(sizeof(type), objectType)
 
 static Object* allocateObject(size_t size, ObjectType type) {
+    allocationType = type;
     Object* object = (Object*)reallocate(NULL, 0, size);
+    allocationType = ALLOCATION_MEMORY;
     object->type = type;
     object->isMarked = false;
 
@@ -56,6 +59,7 @@ ObjectFunction* newFunction() {
     ObjectFunction* function = ALLOCATE_OBJECT(ObjectFunction, OBJECT_FUNCTION);
     function->arity = 0;
     function->upValueCount = 0;
+    function->maxSlots = 0;
     function->name = NULL;
     initChunk(&function->chunk);
     return function;
@@ -46,6 +46,7 @@ typedef struct ObjectFunction {
     Object object;
     int arity;
     int upValueCount;
+    int maxSlots;
     Chunk chunk;
     ObjectString* name;
 } ObjectFunction;
@@ -104,6 +105,7 @@ ObjectInstance* newInstance(ObjectClass* loxClass);
 ObjectNative* newNative(NativeFn function);
 ObjectString* takeString(char* chars, int length);
 ObjectString* copyString(const char* chars, int length);
+uint32_t hashString(const char* key, int length);
 ObjectUpValue* newUpValue(Value* slot);
 void printObject(Value value);
 
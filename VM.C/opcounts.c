@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "chunk.h"
+#include "file.h"
+#include "opcounts.h"
+
+#ifdef DEBUG_COUNT_OPCODES
+
+#ifdef DEBUG_TIME_OPCODES
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#error "DEBUG_TIME_OPCODES needs rdtsc."
+#endif
+#endif
+
+typedef struct OpcodePair {
+    uint16_t first;
+    uint16_t second;
+    uint64_t count;
+} OpcodePair;
+
+static const char* opcodeNames[] = {
+    [OP_CONSTANT] = "OP_CONSTANT",
+    [OP_NIL] = "OP_NIL",
+    [OP_TRUE] = "OP_TRUE",
+    [OP_FALSE] = "OP_FALSE",
+    [OP_POP] = "OP_POP",
+    [OP_GET_LOCAL] = "OP_GET_LOCAL",
+    [OP_SET_LOCAL] = "OP_SET_LOCAL",
+    [OP_GET_GLOBAL] = "OP_GET_GLOBAL",
+    [OP_DEFINE_GLOBAL] = "OP_DEFINE_GLOBAL",
+    [OP_SET_GLOBAL] = "OP_SET_GLOBAL",
+    [OP_GET_UPVALUE] = "OP_GET_UPVALUE",
+    [OP_SET_UPVALUE] = "OP_SET_UPVALUE",
+    [OP_GET_PROPERTY] = "OP_GET_PROPERTY",
+    [OP_SET_PROPERTY] = "OP_SET_PROPERTY",
+    [OP_GET_SUPER] = "OP_GET_SUPER",
+    [OP_EQUAL] = "OP_EQUAL",
+    [OP_GREATER] = "OP_GREATER",
+    [OP_LESS] = "OP_LESS",
+    [OP_ADD] = "OP_ADD",
+    [OP_SUBTRACT] = "OP_SUBTRACT",
+    [OP_MULTIPLY] = "OP_MULTIPLY",
+    [OP_DIVIDE] = "OP_DIVIDE",
+    [OP_NOT] = "OP_NOT",
+    [OP_NEGATE] = "OP_NEGATE",
+    [OP_PRINT] = "OP_PRINT",
+    [OP_JUMP] = "OP_JUMP",
+    [OP_JUMP_IF_FALSE] = "OP_JUMP_IF_FALSE",
+    [OP_LOOP] = "OP_LOOP",
+    [OP_CALL] = "OP_CALL",
+    [OP_TAIL_CALL] = "OP_TAIL_CALL",
+    [OP_INVOKE] = "OP_INVOKE",
+    [OP_SUPER_INVOKE] = "OP_SUPER_INVOKE",
+    [OP_CLOSURE] = "OP_CLOSURE",
+    [OP_CLOSE_UPVALUE] = "OP_CLOSE_UPVALUE",
+    [OP_RETURN] = "OP_RETURN",
+    [OP_CLASS] = "OP_CLASS",
+    [OP_INHERIT] = "OP_INHERIT",
+    [OP_METHOD] = "OP_METHOD",
+    [OP_WIDE] = "OP_WIDE",
+};
+
+#define OPCODE_COUNT (int)(sizeof(opcodeNames) / sizeof(opcodeNames[0]))
+
+// Instructions widened by OP_WIDE are counted apart from their narrow forms,
+// in a second bank of slots written out as WIDE_<op>.
+#define WIDE(instruction) (UINT8_COUNT + (instruction))
+#define SLOT_COUNT (UINT8_COUNT * 2)
+
+static uint64_t counts[SLOT_COUNT];
+static uint64_t pairs[SLOT_COUNT][SLOT_COUNT];
+static int previous = -1;
+
+// The slot counted before previous, for when previous turns out to be the
+// prefix of a wide instruction.
+static int beforePrevious = -1;
+
+#ifdef DEBUG_TIME_OPCODES
+static uint64_t cycles[SLOT_COUNT];
+static uint64_t lastTime;
+#endif
+
+// Called as run() starts so pairs and cycles never span the gap between two
+// calls to interpret().
+void beginOpcodeCounts() {
+    previous = -1;
+    beforePrevious = -1;
+}
+
+// Cycles between two dispatches are charged to the earlier opcode, so an
+// opcode's time includes any natives or garbage collection it triggered.
+void countOpcode(uint8_t instruction) {
+#ifdef DEBUG_TIME_OPCODES
+    uint64_t now = __rdtsc();
+    if (previous >= 0) cycles[previous] += now - lastTime;
+    lastTime = now;
+#endif
+
+    counts[instruction]++;
+    if (previous >= 0) pairs[previous][instruction]++;
+    beforePrevious = previous;
+    previous = instruction;
+}
+
+// Called by OP_WIDE once it has read the instruction it widens. The prefix
+// just counted is replaced by WIDE_<op>, which is charged the prefix's cycles.
+void countWideOpcode(uint8_t instruction) {
+    int wide = WIDE(instruction);
+
+    counts[OP_WIDE]--;
+    counts[wide]++;
+    if (beforePrevious >= 0) {
+        pairs[beforePrevious][OP_WIDE]--;
+        pairs[beforePrevious][wide]++;
+    }
+    previous = wide;
+}
+
+static const char* widePrefix(int slot) {
+    return slot >= UINT8_COUNT ? "WIDE_" : "";
+}
+
+static const char* opcodeName(int slot) {
+    int opcode = slot % UINT8_COUNT;
+    if (opcode < OPCODE_COUNT && opcodeNames[opcode] != NULL) return opcodeNames[opcode];
+    return "OP_UNKNOWN";
+}
+
+static int comparePairs(const void* a, const void* b) {
+    uint64_t left = ((const OpcodePair*)a)->count;
+    uint64_t right = ((const OpcodePair*)b)->count;
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+static void writeOpcodes(FILE* file) {
+    fprintf(file, "  \"opcodes\": [");
+
+    bool first = true;
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        if (counts[slot] == 0) continue;
+
+        fprintf(file, "%s\n    { \"name\": \"%s%s\", \"count\": %llu", first ? "" : ",",
+            widePrefix(slot), opcodeName(slot), (unsigned long long)counts[slot]);
+#ifdef DEBUG_TIME_OPCODES
+        fprintf(file, ", \"cycles\": %llu", (unsigned long long)cycles[slot]);
+#endif
+        fprintf(file, " }");
+        first = false;
+    }
+
+    fprintf(file, "\n  ],\n");
+}
+
+static void writePairs(FILE* file) {
+    OpcodePair* sorted = (OpcodePair*)malloc(sizeof(OpcodePair) * SLOT_COUNT * SLOT_COUNT);
+    int count = 0;
+
+    for (int first = 0; sorted != NULL && first < SLOT_COUNT; first++) {
+        for (int second = 0; second < SLOT_COUNT; second++) {
+            if (pairs[first][second] == 0) continue;
+            sorted[count].first = (uint16_t)first;
+            sorted[count].second = (uint16_t)second;
+            sorted[count].count = pairs[first][second];
+            count++;
+        }
+    }
+
+    if (count > 0) qsort(sorted, count, sizeof(OpcodePair), comparePairs);
+
+    fprintf(file, "  \"pairs\": [");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s\n    { \"first\": \"%s%s\", \"second\": \"%s%s\", \"count\": %llu }",
+            i == 0 ? "" : ",", widePrefix(sorted[i].first), opcodeName(sorted[i].first),
+            widePrefix(sorted[i].second), opcodeName(sorted[i].second), (unsigned long long)sorted[i].count);
+    }
+    fprintf(file, "\n  ]\n");
+
+    free(sorted);
+}
+
+// Opcodes are listed in enum order, narrow forms before wide ones, and pairs
+// from most to least frequent.
+void writeOpcodeCounts(const char* path) {
+    FILE* file = openFile(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not write opcode counts \"%s\".\n", path);
+        return;
+    }
+
+    fprintf(file, "{\n");
+    writeOpcodes(file);
+    writePairs(file);
+    fprintf(file, "}\n");
+    fclose(file);
+}
+
+#endif
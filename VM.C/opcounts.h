@@ -0,0 +1,19 @@
+#ifndef clox_opcounts_h
+#define clox_opcounts_h
+
+#include "common.h"
+
+#ifdef DEBUG_COUNT_OPCODES
+
+#ifndef OPCODE_COUNTS_PATH
+#define OPCODE_COUNTS_PATH "opcodes.json"
+#endif
+
+void beginOpcodeCounts();
+void countOpcode(uint8_t instruction);
+void countWideOpcode(uint8_t instruction);
+void writeOpcodeCounts(const char* path);
+
+#endif
+
+#endif // !clox_opcounts_h
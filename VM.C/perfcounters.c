@@ -0,0 +1,154 @@
+#include <stdio.h>
+
+#include "perfcounters.h"
+
+#ifndef __linux__
+
+bool openPerfCounters() {
+    fprintf(stderr, "Performance counters are only supported on Linux.\n");
+    return false;
+}
+
+void startPerfCounters() {}
+
+void stopPerfCounters() {}
+
+void reportPerfCounters() {}
+
+#else
+
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+typedef enum CounterIndex {
+    COUNTER_TASK_CLOCK,
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCHES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_COUNT,
+} CounterIndex;
+
+typedef struct PerfCounter {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+    int fd;
+} PerfCounter;
+
+static PerfCounter counters[] = {
+    [COUNTER_TASK_CLOCK] = { "task-clock (ns)", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, -1 },
+    [COUNTER_CYCLES] = { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1 },
+    [COUNTER_INSTRUCTIONS] = { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1 },
+    [COUNTER_BRANCHES] = { "branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, -1 },
+    [COUNTER_BRANCH_MISSES] = { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1 },
+    [COUNTER_L1D_MISSES] = { "L1d read misses", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D), -1 },
+    [COUNTER_LLC_MISSES] = { "LLC read misses", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_LL), -1 },
+};
+
+static bool opened = false;
+
+static int openCounter(PerfCounter* counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter->type;
+    attr.config = counter->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Counters are opened individually rather than as a group so one event the
+// CPU or hypervisor does not expose leaves the others usable.
+bool openPerfCounters() {
+    bool any = false;
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        counters[i].fd = openCounter(&counters[i]);
+        if (counters[i].fd >= 0) any = true;
+    }
+
+    if (!any) return false;
+
+    opened = true;
+    // Reports the counters even when the script ends in exit().
+    atexit(reportPerfCounters);
+    return true;
+}
+
+static void controlCounters(unsigned long request) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (counters[i].fd >= 0) ioctl(counters[i].fd, request, 0);
+    }
+}
+
+void startPerfCounters() {
+    if (opened) controlCounters(PERF_EVENT_IOC_ENABLE);
+}
+
+void stopPerfCounters() {
+    if (opened) controlCounters(PERF_EVENT_IOC_DISABLE);
+}
+
+// Events the kernel multiplexed onto too few hardware counters are scaled
+// up by the fraction of time they were actually counting.
+static bool readCounter(PerfCounter* counter, double* value) {
+    uint64_t values[3];
+    if (read(counter->fd, values, sizeof(values)) != sizeof(values)) return false;
+
+    uint64_t enabled = values[1];
+    uint64_t running = values[2];
+    if (running == 0) {
+        *value = 0;
+        return enabled == 0;
+    }
+
+    *value = (double)values[0] * ((double)enabled / (double)running);
+    return true;
+}
+
+void reportPerfCounters() {
+    if (!opened) return;
+
+    stopPerfCounters();
+    opened = false;
+
+    double values[COUNTER_COUNT];
+    bool counted[COUNTER_COUNT];
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        counted[i] = counters[i].fd >= 0 && readCounter(&counters[i], &values[i]);
+        if (counters[i].fd >= 0) close(counters[i].fd);
+        counters[i].fd = -1;
+    }
+
+    fprintf(stderr, "Performance counters:\n");
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (!counted[i]) {
+            fprintf(stderr, "  %-18s %20s\n", counters[i].name, "not supported");
+            continue;
+        }
+
+        fprintf(stderr, "  %-18s %20.0f", counters[i].name, values[i]);
+        if (i == COUNTER_INSTRUCTIONS && counted[COUNTER_CYCLES] && values[COUNTER_CYCLES] > 0) {
+            fprintf(stderr, "  (%.2f per cycle)", values[i] / values[COUNTER_CYCLES]);
+        }
+        else if (i == COUNTER_BRANCH_MISSES && counted[COUNTER_BRANCHES] && values[COUNTER_BRANCHES] > 0) {
+            fprintf(stderr, "  (%.2f%% of branches)", 100 * values[i] / values[COUNTER_BRANCHES]);
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+#endif
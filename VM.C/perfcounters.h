@@ -0,0 +1,11 @@
+#ifndef clox_perfcounters_h
+#define clox_perfcounters_h
+
+#include "common.h"
+
+bool openPerfCounters();
+void startPerfCounters();
+void stopPerfCounters();
+void reportPerfCounters();
+
+#endif // !clox_perfcounters_h
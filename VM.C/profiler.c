@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "file.h"
+#include "memory.h"
+#include "profiler.h"
+#include "vm.h"
+
+#ifdef _WIN32
+
+bool startProfiler(const char* path) {
+    fprintf(stderr, "Profiling is not supported on this platform.\n");
+    return false;
+}
+
+void stopProfiler() {}
+
+void markProfilerRoots() {}
+
+#else
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+#define PROFILE_INDEX_SIZE (PROFILE_MAX_STACKS * 2)
+
+// A NULL function stands for the frames left out of a stack deeper than
+// PROFILE_MAX_DEPTH.
+typedef struct ProfileFrame {
+    ObjectFunction* function;
+    int line;
+} ProfileFrame;
+
+typedef struct ProfileStack {
+    uint32_t hash;
+    int start;
+    int depth;
+    int count;
+} ProfileStack;
+
+// Samples are aggregated inside the signal handler, so everything it touches
+// is allocated up front and nothing is allocated or freed while the timer runs.
+static FILE* output = NULL;
+static ProfileFrame* frames = NULL;
+static ProfileStack* stacks = NULL;
+static int* buckets = NULL;
+static volatile int frameCount = 0;
+static volatile int stackCount = 0;
+static volatile int dropped = 0;
+static ProfileFrame scratch[PROFILE_MAX_DEPTH];
+
+static bool sameStack(ProfileStack* stack, uint32_t hash, int depth) {
+    if (stack->hash != hash || stack->depth != depth) return false;
+
+    for (int i = 0; i < depth; i++) {
+        ProfileFrame* frame = &frames[stack->start + i];
+        if (frame->function != scratch[i].function || frame->line != scratch[i].line) return false;
+    }
+    return true;
+}
+
+static void recordStack(uint32_t hash, int depth) {
+    uint32_t slot = hash & (PROFILE_INDEX_SIZE - 1);
+
+    for (;;) {
+        int entry = buckets[slot];
+        if (entry < 0) break;
+
+        if (sameStack(&stacks[entry], hash, depth)) {
+            stacks[entry].count++;
+            return;
+        }
+        slot = (slot + 1) & (PROFILE_INDEX_SIZE - 1);
+    }
+
+    if (stackCount == PROFILE_MAX_STACKS || frameCount + depth > PROFILE_MAX_FRAMES) {
+        dropped++;
+        return;
+    }
+
+    ProfileStack* stack = &stacks[stackCount];
+    stack->hash = hash;
+    stack->start = frameCount;
+    stack->depth = depth;
+    stack->count = 1;
+
+    for (int i = 0; i < depth; i++) {
+        frames[frameCount + i] = scratch[i];
+    }
+
+    frameCount += depth;
+    buckets[slot] = stackCount++;
+}
+
+static uint32_t addFrame(int depth, uint32_t hash, ObjectFunction* function, int line) {
+    scratch[depth].function = function;
+    scratch[depth].line = line;
+
+    hash = (hash ^ (uint32_t)(uintptr_t)function) * 16777619u;
+    return (hash ^ (uint32_t)line) * 16777619u;
+}
+
+// A tail call can leave a frame briefly pairing the new closure with the old
+// ip, so the line lookup is bounds-checked.
+static uint32_t addCallFrame(int depth, uint32_t hash, CallFrame* frame) {
+    ObjectFunction* function = frame->closure->function;
+    ptrdiff_t offset = frame->ip - function->chunk.code - 1;
+    int line = offset >= 0 && offset < function->chunk.count ? getLine(&function->chunk, (int)offset) : 0;
+
+    return addFrame(depth, hash, function, line);
+}
+
+// Runs on SIGPROF between any two instructions of the interrupted code. The
+// VM fills in a call frame, and copies the array when it grows, behind a
+// release fence before publishing either; the acquire fence here pairs with
+// those.
+//
+// A stack deeper than PROFILE_MAX_DEPTH keeps its outermost frames, so every
+// sample still starts at script, and its innermost ones, where the time is
+// spent. A [truncated] frame stands in for those in between.
+static void sample(int signalNumber) {
+    int count = vm.frameCount;
+    atomic_signal_fence(memory_order_acquire);
+    int outer = count > PROFILE_MAX_DEPTH ? PROFILE_MAX_DEPTH / 2 : count;
+    int inner = count > PROFILE_MAX_DEPTH ? PROFILE_MAX_DEPTH - outer - 1 : 0;
+    int depth = 0;
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < outer; i++) {
+        hash = addCallFrame(depth++, hash, &vm.frames[i]);
+    }
+
+    if (inner > 0) {
+        hash = addFrame(depth++, hash, NULL, 0);
+
+        for (int i = count - inner; i < count; i++) {
+            hash = addCallFrame(depth++, hash, &vm.frames[i]);
+        }
+    }
+
+    if (depth > 0) recordStack(hash, depth);
+}
+
+static void setTimer(long interval) {
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = interval;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+bool startProfiler(const char* path) {
+    output = openFile(path, "w");
+    frames = (ProfileFrame*)malloc(sizeof(ProfileFrame) * PROFILE_MAX_FRAMES);
+    stacks = (ProfileStack*)malloc(sizeof(ProfileStack) * PROFILE_MAX_STACKS);
+    buckets = (int*)malloc(sizeof(int) * PROFILE_INDEX_SIZE);
+
+    if (output == NULL || frames == NULL || stacks == NULL || buckets == NULL) {
+        if (output != NULL) fclose(output);
+        free(frames);
+        free(stacks);
+        free(buckets);
+        output = NULL;
+        return false;
+    }
+
+    for (int i = 0; i < PROFILE_INDEX_SIZE; i++) {
+        buckets[i] = -1;
+    }
+
+    struct sigaction action;
+    action.sa_handler = sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    // Flushes the profile even when the script ends in exit().
+    atexit(stopProfiler);
+    setTimer(PROFILE_INTERVAL_USEC);
+    return true;
+}
+
+static void writeFrame(ProfileFrame* frame) {
+    if (frame->function == NULL) {
+        fprintf(output, "[truncated]");
+        return;
+    }
+
+    ObjectString* name = frame->function->name;
+    if (name == NULL) {
+        fprintf(output, "script:%d", frame->line);
+    }
+    else {
+        fprintf(output, "%.*s:%d", name->length, name->chars, frame->line);
+    }
+}
+
+// Writes one line per distinct stack in the collapsed format flame graph
+// tools read: frames from outermost to innermost joined by ';', then the
+// number of samples.
+void stopProfiler() {
+    if (output == NULL) return;
+
+    setTimer(0);
+    signal(SIGPROF, SIG_DFL);
+
+    for (int i = 0; i < stackCount; i++) {
+        ProfileStack* stack = &stacks[i];
+        for (int j = 0; j < stack->depth; j++) {
+            if (j > 0) fputc(';', output);
+            writeFrame(&frames[stack->start + j]);
+        }
+        fprintf(output, " %d\n", stack->count);
+    }
+
+    if (dropped > 0) {
+        fprintf(stderr, "Profiler dropped %d samples.\n", dropped);
+    }
+
+    fclose(output);
+    free(frames);
+    free(stacks);
+    free(buckets);
+    output = NULL;
+    frames = NULL;
+    stacks = NULL;
+    buckets = NULL;
+    frameCount = 0;
+    stackCount = 0;
+    dropped = 0;
+}
+
+// Sampled functions may no longer be reachable from the program by the time
+// the profile is written.
+void markProfilerRoots() {
+    for (int i = 0; i < frameCount; i++) {
+        markObject((Object*)frames[i].function);
+    }
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef clox_profiler_h
+#define clox_profiler_h
+
+#include "common.h"
+
+#define PROFILE_INTERVAL_USEC 1000
+#define PROFILE_MAX_DEPTH 256
+#define PROFILE_MAX_STACKS 16384
+#define PROFILE_MAX_FRAMES (1 << 20)
+
+bool startProfiler(const char* path);
+void stopProfiler();
+void markProfilerRoots();
+
+#endif // !clox_profiler_h
@@ -4,9 +4,20 @@
 #include "common.h"
 #include "scanner.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 typedef struct Scanner {
 	const char* start;
 	const char* current;
+	// The terminating '\0'. Vector loads only read 16 bytes that end before it.
+	const char* end;
 	int line;
 } Scanner;
 
@@ -15,6 +26,7 @@ Scanner scanner;
 void initScanner(const char* source) {
 	scanner.start = source;
 	scanner.current = source;
+	scanner.end = source + strlen(source);
 	scanner.line = 1;
 }
 
@@ -54,6 +66,74 @@ static bool match(char expected) {
 	return true;
 }
 
+#ifdef SCANNER_SSE2
+
+static int firstSet(unsigned mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static int countSet(unsigned mask) {
+	int count = 0;
+	for (; mask != 0; mask &= mask - 1) count++;
+	return count;
+}
+
+// Returns a mask with a bit set for each of the next 16 bytes equal to c.
+static unsigned matchVector(__m128i bytes, char c) {
+	return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)));
+}
+
+#endif // SCANNER_SSE2
+
+// Comments and strings are the long runs in real source, so they are searched
+// 16 bytes at a time. Whitespace, identifiers and numbers are mostly shorter
+// than a vector and stay scalar, where they measured faster.
+static void skipComment() {
+#ifdef SCANNER_SSE2
+	while (scanner.end - scanner.current >= 16) {
+		unsigned newlines = matchVector(_mm_loadu_si128((const __m128i*)scanner.current), '\n');
+		if (newlines != 0) {
+			scanner.current += firstSet(newlines);
+			return;
+		}
+		scanner.current += 16;
+	}
+#endif // SCANNER_SSE2
+
+	while (peek() != '\n' && !isAtEnd()) advance();
+}
+
+static void skipStringBody() {
+#ifdef SCANNER_SSE2
+	while (scanner.end - scanner.current >= 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i*)scanner.current);
+		unsigned quotes = matchVector(bytes, '"');
+		unsigned newlines = matchVector(bytes, '\n');
+
+		if (quotes != 0) {
+			int length = firstSet(quotes);
+			scanner.line += countSet(newlines & ((1u << length) - 1));
+			scanner.current += length;
+			return;
+		}
+
+		scanner.line += countSet(newlines);
+		scanner.current += 16;
+	}
+#endif // SCANNER_SSE2
+
+	while (peek() != '"' && !isAtEnd()) {
+		if (peek() == '\n') scanner.line++;
+		advance();
+	}
+}
+
 static Token makeToken(TokenType type) {
 	Token token;
 	token.type = type;
@@ -88,7 +168,7 @@ static void skipWhitespace() {
 			break;
 		case '/':
 			if (peekNext() == '/') {
-				while (peek() != '\n' && !isAtEnd()) advance();
+				skipComment();
 			}
 			else {
 				return;
@@ -162,10 +242,7 @@ static Token number() {
 }
 
 static Token string() {
-	while (peek() != '"' && !isAtEnd()) {
-		if (peek() == '\n') scanner.line++;
-		advance();
-	}
+	skipStringBody();
 
 	if (isAtEnd()) return errorToken("Unterminated string.");
 
@@ -0,0 +1,600 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "object.h"
+#include "snapshot.h"
+#include "vm.h"
+
+#define SNAPSHOT_MAGIC "LOXS"
+#define NO_OBJECT -1
+
+// An image has two object sections. Shells are written in type order so an object
+// only ever refers back to objects already created (a closure to its function, an
+// instance to its class). Links fill in everything that may form a cycle: constants,
+// upvalues, method and field tables, bound receivers. The globals follow last.
+
+typedef enum ValueTag {
+    VALUE_TAG_NIL,
+    VALUE_TAG_FALSE,
+    VALUE_TAG_TRUE,
+    VALUE_TAG_NUMBER,
+    VALUE_TAG_OBJECT,
+} ValueTag;
+
+typedef struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t objectCount;
+    uint32_t reserved;
+} SnapshotHeader;
+
+typedef struct ObjectMap {
+    Object** objects;
+    int count;
+    int capacity;
+
+    Object** keys;
+    int* indices;
+    int mapCapacity;
+} ObjectMap;
+
+typedef struct Reader {
+    const uint8_t* start;
+    const uint8_t* current;
+    const uint8_t* end;
+    bool hadError;
+} Reader;
+
+static Object** loaded = NULL;
+static int loadedCount = 0;
+
+static int typeRank(ObjectType type) {
+    switch (type)
+    {
+    case OBJECT_STRING:         return 0;
+    case OBJECT_FUNCTION:       return 1;
+    case OBJECT_NATIVE:         return 2;
+    case OBJECT_CLOSURE:        return 3;
+    case OBJECT_UPVALUE:        return 4;
+    case OBJECT_CLASS:          return 5;
+    case OBJECT_INSTANCE:       return 6;
+    case OBJECT_BOUND_METHOD:   return 7;
+    }
+    return 0;
+}
+
+#define TYPE_RANKS 8
+
+static uint32_t hashPointer(Object* object) {
+    uint64_t bits = (uint64_t)(uintptr_t)object;
+    return (uint32_t)((bits >> 3) * 2654435761u);
+}
+
+static int findIndex(ObjectMap* map, Object* object) {
+    if (map->mapCapacity == 0) return NO_OBJECT;
+
+    uint32_t index = hashPointer(object) & (map->mapCapacity - 1);
+    for (;;) {
+        if (map->keys[index] == NULL) return NO_OBJECT;
+        if (map->keys[index] == object) return map->indices[index];
+        index = (index + 1) & (map->mapCapacity - 1);
+    }
+}
+
+static void insertIndex(ObjectMap* map, Object* object, int objectIndex) {
+    uint32_t index = hashPointer(object) & (map->mapCapacity - 1);
+    while (map->keys[index] != NULL && map->keys[index] != object) {
+        index = (index + 1) & (map->mapCapacity - 1);
+    }
+    map->keys[index] = object;
+    map->indices[index] = objectIndex;
+}
+
+static void rebuildIndices(ObjectMap* map, int mapCapacity) {
+    if (mapCapacity < 8) mapCapacity = 8;
+
+    free(map->keys);
+    free(map->indices);
+    map->keys = (Object**)calloc(mapCapacity, sizeof(Object*));
+    map->indices = (int*)calloc(mapCapacity, sizeof(int));
+    map->mapCapacity = mapCapacity;
+    if (map->keys == NULL || map->indices == NULL) exit(1);
+
+    for (int i = 0; i < map->count; i++) {
+        insertIndex(map, map->objects[i], i);
+    }
+}
+
+static void collectObject(ObjectMap* map, Object* object) {
+    if (object == NULL || findIndex(map, object) != NO_OBJECT) return;
+
+    if (map->capacity < map->count + 1) {
+        map->capacity = GROW_CAPACITY(map->capacity);
+        map->objects = (Object**)realloc(map->objects, sizeof(Object*) * map->capacity);
+        if (map->objects == NULL) exit(1);
+    }
+    map->objects[map->count++] = object;
+
+    if (map->count * 2 > map->mapCapacity) {
+        rebuildIndices(map, GROW_CAPACITY(map->mapCapacity) * 2);
+    }
+    else {
+        insertIndex(map, object, map->count - 1);
+    }
+}
+
+static void collectValue(ObjectMap* map, Value value) {
+    if (IS_OBJECT(value)) collectObject(map, AS_OBJECT(value));
+}
+
+static void collectTable(ObjectMap* map, Table* table) {
+    for (int i = 0; i < table->capacity; i++) {
+        Entry* entry = &table->entries[i];
+        if (entry->key == NULL) continue;
+        collectObject(map, (Object*)entry->key);
+        collectValue(map, entry->value);
+    }
+}
+
+static void collectReferences(ObjectMap* map, Object* object) {
+    switch (object->type)
+    {
+    case OBJECT_BOUND_METHOD: {
+        ObjectBoundMethod* boundMethod = (ObjectBoundMethod*)object;
+        collectValue(map, boundMethod->receiver);
+        collectObject(map, (Object*)boundMethod->method);
+        break;
+    }
+    case OBJECT_CLASS: {
+        ObjectClass* loxClass = (ObjectClass*)object;
+        collectObject(map, (Object*)loxClass->name);
+        collectTable(map, &loxClass->methods);
+        break;
+    }
+    case OBJECT_CLOSURE: {
+        ObjectClosure* closure = (ObjectClosure*)object;
+        collectObject(map, (Object*)closure->function);
+        for (int i = 0; i < closure->upValueCount; i++) {
+            collectObject(map, (Object*)closure->upValues[i]);
+        }
+        break;
+    }
+    case OBJECT_FUNCTION: {
+        ObjectFunction* function = (ObjectFunction*)object;
+        collectObject(map, (Object*)function->name);
+        for (int i = 0; i < function->chunk.constants.count; i++) {
+            collectValue(map, function->chunk.constants.values[i]);
+        }
+        break;
+    }
+    case OBJECT_INSTANCE: {
+        ObjectInstance* instance = (ObjectInstance*)object;
+        collectObject(map, (Object*)instance->loxClass);
+        collectTable(map, &instance->fields);
+        break;
+    }
+    case OBJECT_UPVALUE:
+        collectValue(map, *((ObjectUpValue*)object)->location);
+        break;
+    case OBJECT_NATIVE:
+    case OBJECT_STRING:
+        break;
+    }
+}
+
+static void sortByType(ObjectMap* map) {
+    Object** sorted = (Object**)malloc(sizeof(Object*) * (map->count + 1));
+    if (sorted == NULL) exit(1);
+
+    int count = 0;
+    for (int rank = 0; rank < TYPE_RANKS; rank++) {
+        for (int i = 0; i < map->count; i++) {
+            if (typeRank(map->objects[i]->type) == rank) sorted[count++] = map->objects[i];
+        }
+    }
+
+    free(map->objects);
+    map->objects = sorted;
+    map->capacity = map->count + 1;
+    rebuildIndices(map, map->mapCapacity);
+}
+
+static void freeObjectMap(ObjectMap* map) {
+    free(map->objects);
+    free(map->keys);
+    free(map->indices);
+}
+
+static void writeInt(FILE* file, int32_t value) {
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+static void writeObjectIndex(FILE* file, ObjectMap* map, Object* object) {
+    writeInt(file, object == NULL ? NO_OBJECT : findIndex(map, object));
+}
+
+static void writeValue(FILE* file, ObjectMap* map, Value value) {
+    if (IS_NIL(value)) {
+        fputc(VALUE_TAG_NIL, file);
+    }
+    else if (IS_BOOL(value)) {
+        fputc(AS_BOOL(value) ? VALUE_TAG_TRUE : VALUE_TAG_FALSE, file);
+    }
+    else if (IS_NUMBER(value)) {
+        double number = AS_NUMBER(value);
+        fputc(VALUE_TAG_NUMBER, file);
+        fwrite(&number, sizeof(number), 1, file);
+    }
+    else {
+        fputc(VALUE_TAG_OBJECT, file);
+        writeObjectIndex(file, map, AS_OBJECT(value));
+    }
+}
+
+static void writeTable(FILE* file, ObjectMap* map, Table* table) {
+    int count = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->entries[i].key != NULL) count++;
+    }
+
+    writeInt(file, count);
+    for (int i = 0; i < table->capacity; i++) {
+        Entry* entry = &table->entries[i];
+        if (entry->key == NULL) continue;
+        writeObjectIndex(file, map, (Object*)entry->key);
+        writeValue(file, map, entry->value);
+    }
+}
+
+static void writeShell(FILE* file, ObjectMap* map, Object* object) {
+    fputc(object->type, file);
+
+    switch (object->type)
+    {
+    case OBJECT_STRING: {
+        ObjectString* string = (ObjectString*)object;
+        writeInt(file, string->length);
+        fwrite(string->chars, sizeof(char), string->length, file);
+        break;
+    }
+    case OBJECT_FUNCTION: {
+        ObjectFunction* function = (ObjectFunction*)object;
+        writeInt(file, function->arity);
+        writeInt(file, function->upValueCount);
+        writeInt(file, function->maxSlots);
+        writeObjectIndex(file, map, (Object*)function->name);
+        writeInt(file, function->chunk.count);
+        fwrite(function->chunk.code, sizeof(uint8_t), function->chunk.count, file);
+        while (ftell(file) % sizeof(int) != 0) {
+            fputc(0, file);
+        }
+        writeInt(file, function->chunk.lineCount);
+        fwrite(function->chunk.lines, sizeof(LineStart), function->chunk.lineCount, file);
+        break;
+    }
+    case OBJECT_NATIVE:
+        writeInt(file, findNative(((ObjectNative*)object)->function));
+        break;
+    case OBJECT_CLOSURE:
+        writeObjectIndex(file, map, (Object*)((ObjectClosure*)object)->function);
+        break;
+    case OBJECT_CLASS:
+        writeObjectIndex(file, map, (Object*)((ObjectClass*)object)->name);
+        break;
+    case OBJECT_INSTANCE:
+        writeObjectIndex(file, map, (Object*)((ObjectInstance*)object)->loxClass);
+        break;
+    case OBJECT_UPVALUE:
+    case OBJECT_BOUND_METHOD:
+        break;
+    }
+}
+
+static void writeLinks(FILE* file, ObjectMap* map, Object* object) {
+    switch (object->type)
+    {
+    case OBJECT_FUNCTION: {
+        ValueArray* constants = &((ObjectFunction*)object)->chunk.constants;
+        writeInt(file, constants->count);
+        for (int i = 0; i < constants->count; i++) {
+            writeValue(file, map, constants->values[i]);
+        }
+        break;
+    }
+    case OBJECT_CLOSURE: {
+        ObjectClosure* closure = (ObjectClosure*)object;
+        for (int i = 0; i < closure->upValueCount; i++) {
+            writeObjectIndex(file, map, (Object*)closure->upValues[i]);
+        }
+        break;
+    }
+    case OBJECT_UPVALUE:
+        writeValue(file, map, *((ObjectUpValue*)object)->location);
+        break;
+    case OBJECT_CLASS:
+        writeTable(file, map, &((ObjectClass*)object)->methods);
+        break;
+    case OBJECT_INSTANCE:
+        writeTable(file, map, &((ObjectInstance*)object)->fields);
+        break;
+    case OBJECT_BOUND_METHOD: {
+        ObjectBoundMethod* boundMethod = (ObjectBoundMethod*)object;
+        writeValue(file, map, boundMethod->receiver);
+        writeObjectIndex(file, map, (Object*)boundMethod->method);
+        break;
+    }
+    case OBJECT_NATIVE:
+    case OBJECT_STRING:
+        break;
+    }
+}
+
+bool writeSnapshot(const char* path) {
+    ObjectMap map = { 0 };
+
+    collectTable(&map, &vm.globals);
+    for (int i = 0; i < map.count; i++) {
+        collectReferences(&map, map.objects[i]);
+    }
+    sortByType(&map);
+
+    // Functions restored from an image keep their code in its mapping, and that
+    // image may be the one being written, so it is replaced, not overwritten.
+    ReplacementFile replacement;
+    if (!openReplacement(path, &replacement)) {
+        freeObjectMap(&map);
+        return false;
+    }
+    FILE* file = replacement.stream;
+
+    SnapshotHeader header = { .version = SNAPSHOT_VERSION, .objectCount = map.count };
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (int i = 0; i < map.count; i++) {
+        writeShell(file, &map, map.objects[i]);
+    }
+    for (int i = 0; i < map.count; i++) {
+        writeLinks(file, &map, map.objects[i]);
+    }
+    writeTable(file, &map, &vm.globals);
+
+    bool written = commitReplacement(&replacement);
+
+    freeObjectMap(&map);
+    return written;
+}
+
+static const uint8_t* readBytes(Reader* reader, size_t size) {
+    if (reader->hadError || (size_t)(reader->end - reader->current) < size) {
+        reader->hadError = true;
+        return NULL;
+    }
+
+    const uint8_t* bytes = reader->current;
+    reader->current += size;
+    return bytes;
+}
+
+static int32_t readInt(Reader* reader) {
+    int32_t value = 0;
+    const uint8_t* bytes = readBytes(reader, sizeof(value));
+    if (bytes != NULL) memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint8_t readByte(Reader* reader) {
+    const uint8_t* bytes = readBytes(reader, sizeof(uint8_t));
+    return bytes != NULL ? *bytes : 0;
+}
+
+// Shells may only refer to objects that were created before them.
+static Object* readObject(Reader* reader, int limit, ObjectType type) {
+    int index = readInt(reader);
+    if (index == NO_OBJECT) return NULL;
+
+    if (index < 0 || index >= limit || loaded[index]->type != type) {
+        reader->hadError = true;
+        return NULL;
+    }
+    return loaded[index];
+}
+
+static Value readValue(Reader* reader) {
+    switch (readByte(reader))
+    {
+    case VALUE_TAG_NIL:     return NIL_VALUE;
+    case VALUE_TAG_FALSE:   return BOOL_VALUE(false);
+    case VALUE_TAG_TRUE:    return BOOL_VALUE(true);
+    case VALUE_TAG_NUMBER: {
+        double number = 0;
+        const uint8_t* bytes = readBytes(reader, sizeof(number));
+        if (bytes != NULL) memcpy(&number, bytes, sizeof(number));
+        return NUMBER_VALUE(number);
+    }
+    case VALUE_TAG_OBJECT: {
+        int index = readInt(reader);
+        if (index < 0 || index >= loadedCount) break;
+        return OBJECT_VALUE(loaded[index]);
+    }
+    default:
+        break;
+    }
+
+    reader->hadError = true;
+    return NIL_VALUE;
+}
+
+static void readTable(Reader* reader, Table* table) {
+    int count = readInt(reader);
+    for (int i = 0; i < count && !reader->hadError; i++) {
+        ObjectString* key = (ObjectString*)readObject(reader, loadedCount, OBJECT_STRING);
+        Value value = readValue(reader);
+        if (key == NULL) reader->hadError = true;
+        if (reader->hadError) return;
+        tableSet(table, key, value);
+    }
+}
+
+static Object* readShell(Reader* reader) {
+    int limit = loadedCount;
+
+    switch (readByte(reader))
+    {
+    case OBJECT_STRING: {
+        int length = readInt(reader);
+        const uint8_t* chars = length >= 0 ? readBytes(reader, length) : NULL;
+        if (chars == NULL) return NULL;
+        return (Object*)copyString((const char*)chars, length);
+    }
+    case OBJECT_FUNCTION: {
+        ObjectFunction* function = newFunction();
+        function->arity = readInt(reader);
+        function->upValueCount = readInt(reader);
+        function->maxSlots = readInt(reader);
+        function->name = (ObjectString*)readObject(reader, limit, OBJECT_STRING);
+
+        // Like cached bytecode, code and lines stay in the mapped image.
+        int count = readInt(reader);
+        const uint8_t* code = count >= 0 ? readBytes(reader, count) : NULL;
+        readBytes(reader, (sizeof(int) - (reader->current - reader->start) % sizeof(int)) % sizeof(int));
+        int lineCount = readInt(reader);
+        const uint8_t* lines = lineCount >= 0 ? readBytes(reader, sizeof(LineStart) * lineCount) : NULL;
+        if (code == NULL || lines == NULL) return NULL;
+
+        function->chunk.code = (uint8_t*)code;
+        function->chunk.count = count;
+        function->chunk.lines = (LineStart*)lines;
+        function->chunk.lineCount = lineCount;
+        return (Object*)function;
+    }
+    case OBJECT_NATIVE: {
+        NativeFn native = getNative(readInt(reader));
+        if (native == NULL) return NULL;
+        return (Object*)newNative(native);
+    }
+    case OBJECT_CLOSURE: {
+        ObjectFunction* function = (ObjectFunction*)readObject(reader, limit, OBJECT_FUNCTION);
+        if (function == NULL || function->upValueCount < 0) return NULL;
+        return (Object*)newClosure(function);
+    }
+    case OBJECT_UPVALUE: {
+        ObjectUpValue* upValue = newUpValue(NULL);
+        upValue->location = &upValue->closed;
+        return (Object*)upValue;
+    }
+    case OBJECT_CLASS: {
+        ObjectString* name = (ObjectString*)readObject(reader, limit, OBJECT_STRING);
+        if (name == NULL) return NULL;
+        return (Object*)newClass(name);
+    }
+    case OBJECT_INSTANCE: {
+        ObjectClass* loxClass = (ObjectClass*)readObject(reader, limit, OBJECT_CLASS);
+        if (loxClass == NULL) return NULL;
+        return (Object*)newInstance(loxClass);
+    }
+    case OBJECT_BOUND_METHOD:
+        return (Object*)newBoundMethod(NIL_VALUE, NULL);
+    default:
+        return NULL;
+    }
+}
+
+static void readLinks(Reader* reader, Object* object) {
+    switch (object->type)
+    {
+    case OBJECT_FUNCTION: {
+        ObjectFunction* function = (ObjectFunction*)object;
+        int count = readInt(reader);
+        for (int i = 0; i < count && !reader->hadError; i++) {
+            Value value = readValue(reader);
+            if (!reader->hadError) addConstant(&function->chunk, value);
+        }
+        break;
+    }
+    case OBJECT_CLOSURE: {
+        ObjectClosure* closure = (ObjectClosure*)object;
+        for (int i = 0; i < closure->upValueCount; i++) {
+            closure->upValues[i] = (ObjectUpValue*)readObject(reader, loadedCount, OBJECT_UPVALUE);
+        }
+        break;
+    }
+    case OBJECT_UPVALUE:
+        ((ObjectUpValue*)object)->closed = readValue(reader);
+        break;
+    case OBJECT_CLASS:
+        readTable(reader, &((ObjectClass*)object)->methods);
+        break;
+    case OBJECT_INSTANCE:
+        readTable(reader, &((ObjectInstance*)object)->fields);
+        break;
+    case OBJECT_BOUND_METHOD: {
+        ObjectBoundMethod* boundMethod = (ObjectBoundMethod*)object;
+        boundMethod->receiver = readValue(reader);
+        boundMethod->method = (ObjectClosure*)readObject(reader, loadedCount, OBJECT_CLOSURE);
+        if (boundMethod->method == NULL) reader->hadError = true;
+        break;
+    }
+    case OBJECT_NATIVE:
+    case OBJECT_STRING:
+        break;
+    }
+}
+
+bool loadSnapshot(const MappedFile* image) {
+    Reader reader = {
+        .start = (const uint8_t*)image->data,
+        .current = (const uint8_t*)image->data,
+        .end = (const uint8_t*)image->data + image->size,
+        .hadError = false
+    };
+
+    SnapshotHeader header;
+    const uint8_t* bytes = readBytes(&reader, sizeof(header));
+    if (bytes == NULL) return false;
+    memcpy(&header, bytes, sizeof(header));
+
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.objectCount < 0) {
+        return false;
+    }
+
+    // Every object created so far is a GC root until the globals take over.
+    loaded = (Object**)malloc(sizeof(Object*) * (header.objectCount + 1));
+    if (loaded == NULL) return false;
+    loadedCount = 0;
+
+    for (int i = 0; i < header.objectCount && !reader.hadError; i++) {
+        Object* object = readShell(&reader);
+        if (object == NULL) {
+            reader.hadError = true;
+            break;
+        }
+        loaded[loadedCount++] = object;
+    }
+
+    for (int i = 0; i < loadedCount && !reader.hadError; i++) {
+        readLinks(&reader, loaded[i]);
+    }
+
+    Table globals;
+    initTable(&globals);
+    if (!reader.hadError) readTable(&reader, &globals);
+
+    bool succeeded = !reader.hadError && reader.current == reader.end;
+    if (succeeded) tableAddAll(&globals, &vm.globals);
+    freeTable(&globals);
+
+    free(loaded);
+    loaded = NULL;
+    loadedCount = 0;
+    return succeeded;
+}
+
+void markSnapshotRoots() {
+    for (int i = 0; i < loadedCount; i++) {
+        markObject(loaded[i]);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef clox_snapshot_h
+#define clox_snapshot_h
+
+#include "file.h"
+
+#define SNAPSHOT_VERSION 3
+
+bool writeSnapshot(const char* path);
+bool loadSnapshot(const MappedFile* image);
+void markSnapshotRoots();
+
+#endif // !clox_snapshot_h
@@ -0,0 +1,190 @@
+// Differential fuzzer for the scanner: scans every input with both the current
+// scanner and a baseline build of it and stops at the first token that differs.
+// scanfuzz.sh builds it; see README.md.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../scanner.h"
+
+// The baseline scanner, compiled with its entry points renamed.
+void baselineInitScanner(const char* source);
+Token baselineScanToken();
+
+static const char* pieces[] = {
+	"and", "class", "else", "false", "for", "fun", "if", "nil", "or", "print", "return",
+	"super", "this", "true", "var", "while", "an", "classy", "fals", "fo", "funk", "i", "ni",
+	"o", "prin", "returns", "supe", "th", "tru", "va", "whil", "_x", "x1", "Abc_9", "tr", "fa",
+	"0", "123", "4.5", "6.", ".7", "//", "// comment\n", "/", "\"", "\"str\"", "\"multi\nline\"",
+	" ", "  ", "\t", "\r", "\n", "\r\n", "(", ")", "{", "}", ";", ":", ",", ".", "-", "+", "*",
+	"!", "!=", "=", "==", "<", "<=", ">", ">=", "@", "#", "\x80", "\xff", "~",
+};
+
+#define PIECE_COUNT (sizeof(pieces) / sizeof(pieces[0]))
+
+// Sources up to this long, so long comments and strings cross many vectors.
+#define MAX_SOURCE 8192
+
+static uint64_t state;
+
+static uint32_t next() {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return (uint32_t)(state >> 32);
+}
+
+static void append(char* source, int* length, const char* text, int count) {
+	if (*length + count > MAX_SOURCE) count = MAX_SOURCE - *length;
+	memcpy(source + *length, text, count);
+	*length += count;
+}
+
+// Mixes tokens, stray bytes and long runs of one character. Runs of spaces,
+// newlines, quotes and slashes are what reach the 16 byte loops.
+static int generate(char* source, int iteration) {
+	int length = 0;
+	int target = (int)(next() % (iteration % 10 == 0 ? MAX_SOURCE : 256));
+
+	while (length < target) {
+		uint32_t choice = next() % 8;
+		if (choice == 0) {
+			char byte = (char)(1 + next() % 255);
+			append(source, &length, &byte, 1);
+		}
+		else if (choice == 1) {
+			char run[64];
+			int count = (int)(next() % sizeof(run));
+			memset(run, " \n\tax9_\"/"[next() % 9], count);
+			append(source, &length, run, count);
+		}
+		else {
+			const char* piece = pieces[next() % PIECE_COUNT];
+			append(source, &length, piece, (int)strlen(piece));
+		}
+	}
+
+	return length;
+}
+
+static bool sameToken(Token current, Token baseline) {
+	if (current.type != baseline.type) return false;
+	if (current.length != baseline.length || current.line != baseline.line) return false;
+
+	// Error tokens point at their message rather than into the source.
+	if (current.type == TOKEN_ERROR) return strcmp(current.start, baseline.start) == 0;
+	return current.start == baseline.start;
+}
+
+// The source is copied to an allocation of exactly its size, so a sanitizer
+// catches any read past the terminator.
+static bool compare(const char* text, int length, const char* name, long* tokens) {
+	char* source = (char*)malloc(length + 1);
+	memcpy(source, text, length);
+	source[length] = '\0';
+
+	initScanner(source);
+	baselineInitScanner(source);
+
+	bool same = true;
+	for (;;) {
+		Token current = scanToken();
+		Token baseline = baselineScanToken();
+		(*tokens)++;
+
+		if (!sameToken(current, baseline)) {
+			fprintf(stderr, "%s: tokens differ at offset %ld: type %d, length %d, line %d "
+				"but the baseline has type %d, length %d, line %d.\n",
+				name, (long)(baseline.start - source), current.type, current.length, current.line,
+				baseline.type, baseline.length, baseline.line);
+			same = false;
+			break;
+		}
+		if (current.type == TOKEN_EOF) break;
+	}
+
+	free(source);
+	return same;
+}
+
+static char* readFile(const char* path, int* length) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return NULL;
+
+	fseek(file, 0L, SEEK_END);
+	*length = (int)ftell(file);
+	rewind(file);
+
+	char* text = (char*)malloc(*length + 1);
+	if (fread(text, 1, *length, file) < (size_t)*length) {
+		free(text);
+		text = NULL;
+	}
+	fclose(file);
+	return text;
+}
+
+static void usage() {
+	fprintf(stderr, "Usage: scanfuzz [-n iterations] [-s seed] [file...]\n");
+	exit(64);
+}
+
+int main(int argc, const char* argv[]) {
+	long iterations = 100000;
+	uint64_t seed = 1;
+	long tokens = 0;
+	int sources = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			iterations = strtol(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (argv[i][0] == '-') {
+			usage();
+		}
+		else {
+			int length;
+			char* text = readFile(argv[i], &length);
+			if (text == NULL) {
+				fprintf(stderr, "Could not read \"%s\".\n", argv[i]);
+				return 74;
+			}
+
+			bool same = compare(text, length, argv[i], &tokens);
+			free(text);
+			if (!same) return 1;
+			sources++;
+		}
+	}
+
+	// xorshift never leaves zero.
+	state = seed == 0 ? 1 : seed;
+
+	char* source = (char*)malloc(MAX_SOURCE);
+	for (long i = 0; i < iterations; i++) {
+		int length = generate(source, (int)i);
+
+		char name[64];
+		snprintf(name, sizeof(name), "source %ld (seed %llu)", i, (unsigned long long)seed);
+		if (!compare(source, length, name, &tokens)) {
+			FILE* file = fopen("scanfuzz-failure.lox", "wb");
+			if (file != NULL) {
+				fwrite(source, 1, length, file);
+				fclose(file);
+				fprintf(stderr, "Wrote the source to scanfuzz-failure.lox.\n");
+			}
+			free(source);
+			return 1;
+		}
+		sources++;
+	}
+	free(source);
+
+	printf("%d sources, %ld tokens: no differences.\n", sources, tokens);
+	return 0;
+}
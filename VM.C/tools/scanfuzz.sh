@@ -0,0 +1,28 @@
+#!/bin/sh
+# Builds scanfuzz under ASan and UBSan against the scanner from a baseline
+# revision and runs it. The default baseline is the byte-at-a-time scanner from
+# before the SSE2 loops were added.
+#
+# Usage: VM.C/tools/scanfuzz.sh [-b revision] [scanfuzz arguments...]
+set -e
+
+tools=$(cd "$(dirname "$0")" && pwd)
+vm=$(dirname "$tools")
+build="$tools/build"
+baseline=eb46cee~1
+
+if [ "$1" = "-b" ]; then
+	baseline=$2
+	shift 2
+fi
+
+mkdir -p "$build"
+git -C "$vm" show "$baseline:VM.C/scanner.c" > "$build/baseline_scanner.c"
+
+${CC:-cc} -std=c17 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=all \
+	-I"$vm" -Dscanner=baselineScanner -DinitScanner=baselineInitScanner -DscanToken=baselineScanToken \
+	-c "$build/baseline_scanner.c" -o "$build/baseline_scanner.o"
+${CC:-cc} -std=c17 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=all \
+	"$tools/scanfuzz.c" "$vm/scanner.c" "$build/baseline_scanner.o" -o "$build/scanfuzz"
+
+"$build/scanfuzz" "$@"
@@ -72,4 +72,40 @@ bool valuesEqual(Value a, Value b) {
     default:            return false;
     }
 #endif // NAN_BOXING
-}
\ No newline at end of file
+}
+
+static uint64_t valueBits(Value value) {
+#ifdef NAN_BOXING
+    return value;
+#else
+    uint64_t bits = 0;
+    switch (value.type)
+    {
+    case VALUE_BOOL:    bits = AS_BOOL(value); break;
+    case VALUE_NUMBER:  memcpy(&bits, &value.as.number, sizeof(double)); break;
+    case VALUE_OBJECT:  bits = (uint64_t)(uintptr_t)AS_OBJECT(value); break;
+    default: break;
+    }
+    return bits;
+#endif // NAN_BOXING
+}
+
+// Unlike valuesEqual, tells 0 from -0 apart and matches a NaN with the same
+// bits, so one can stand in for the other as a constant.
+bool valuesIdentical(Value a, Value b) {
+#ifndef NAN_BOXING
+    if (a.type != b.type) return false;
+#endif // !NAN_BOXING
+    return valueBits(a) == valueBits(b);
+}
+
+uint32_t hashValue(Value value) {
+    uint64_t bits = valueBits(value);
+#ifndef NAN_BOXING
+    bits ^= (uint64_t)value.type << 56;
+#endif // !NAN_BOXING
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdull;
+    bits ^= bits >> 33;
+    return (uint32_t)bits;
+}
@@ -90,6 +90,8 @@ typedef struct ValueArray {
 } ValueArray;
 
 bool valuesEqual(Value a, Value b);
+bool valuesIdentical(Value a, Value b);
+uint32_t hashValue(Value value);
 void initValueArray(ValueArray* array);
 void writeValueArray(ValueArray* array, Value value);
 void freeValueArray(ValueArray* array);
@@ -1,5 +1,7 @@
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -8,6 +10,7 @@
 #include "debug.h"
 #include "memory.h"
 #include "object.h"
+#include "opcounts.h"
 #include "vm.h"
 
 VM vm;
@@ -16,12 +19,97 @@ static Value clockNative(int argCount, Value* args) {
     return NUMBER_VALUE((double)clock() / CLOCKS_PER_SEC);
 }
 
+static NativeFn natives[] = {
+    clockNative,
+};
+
+int findNative(NativeFn function) {
+    for (int i = 0; i < (int)(sizeof(natives) / sizeof(natives[0])); i++) {
+        if (natives[i] == function) return i;
+    }
+    return -1;
+}
+
+NativeFn getNative(int index) {
+    if (index < 0 || index >= (int)(sizeof(natives) / sizeof(natives[0]))) return NULL;
+    return natives[index];
+}
+
+static void* reallocVM(void* pointer, size_t size) {
+    void* result = realloc(pointer, size);
+    if (result == NULL) exit(1);
+    return result;
+}
+
+static void growStack(int slotsNeeded) {
+    int capacity = (int)(vm.stackLimit - vm.stack);
+    int count = (int)(vm.stackTop - vm.stack);
+    while (capacity < count + slotsNeeded) {
+        capacity = GROW_CAPACITY(capacity);
+    }
+
+    // Not routed through reallocate(): the VM owns its stack the same way it owns grayStack.
+    // The old stack is kept until every pointer into it has been rebased.
+    Value* stack = (Value*)reallocVM(NULL, sizeof(Value) * capacity);
+    memcpy(stack, vm.stack, sizeof(Value) * count);
+
+    for (int i = 0; i < vm.frameCount; i++) {
+        vm.frames[i].slots = stack + (vm.frames[i].slots - vm.stack);
+    }
+
+    for (ObjectUpValue* upValue = vm.openUpValues; upValue != NULL; upValue = upValue->next) {
+        upValue->location = stack + (upValue->location - vm.stack);
+    }
+
+    free(vm.stack);
+    vm.stack = stack;
+    vm.stackLimit = stack + capacity;
+    vm.stackTop = stack + count;
+}
+
+static void ensureStack(ObjectFunction* function) {
+    // maxSlots counts from the frame base; the headroom covers transient pushes in the runtime.
+    int slotsNeeded = function->maxSlots + STACK_HEADROOM;
+    if (vm.stackLimit - vm.stackTop < slotsNeeded) {
+        growStack(slotsNeeded);
+    }
+}
+
+static void growFrames() {
+    int capacity = GROW_CAPACITY(vm.frameCapacity);
+    if (capacity > vm.framesMax) capacity = vm.framesMax;
+
+    // The profiler reads frames from a signal handler, so the old array stays
+    // valid until the new one is in place.
+    CallFrame* frames = (CallFrame*)reallocVM(NULL, sizeof(CallFrame) * capacity);
+    if (vm.frameCount > 0) memcpy(frames, vm.frames, sizeof(CallFrame) * vm.frameCount);
+
+    CallFrame* oldFrames = vm.frames;
+    atomic_signal_fence(memory_order_release);
+    vm.frames = frames;
+    vm.frameCapacity = capacity;
+    free(oldFrames);
+}
+
 static void resetStack() {
     vm.stackTop = vm.stack;
     vm.frameCount = 0;
     vm.openUpValues = NULL;
 }
 
+static void printFrame(CallFrame* frame) {
+    ObjectFunction* function = frame->closure->function;
+    size_t instruction = frame->ip - function->chunk.code - 1;
+
+    fprintf(stderr, "[line %d] in ", getLine(&function->chunk, (int)instruction));
+    if (function->name == NULL) {
+        fprintf(stderr, "script\n");
+    }
+    else {
+        fprintf(stderr, "%s()\n", function->name->chars);
+    }
+}
+
 static void runtimeError(const char* format, ...) {
     va_list args;
     va_start(args, format);
@@ -29,18 +117,17 @@ static void runtimeError(const char* format, ...) {
     va_end(args);
     fputs("\n", stderr);
 
+    // A deep recursion would print a line per frame, so only the innermost and
+    // outermost frames are listed.
+    int skipFrom = vm.frameCount - TRACE_FRAMES;
+    int skipTo = TRACE_FRAMES;
     for (int i = vm.frameCount - 1; i >= 0; i--) {
-        CallFrame* frame = &vm.frames[i];
-        ObjectFunction* function = frame->closure->function;
-        size_t instruction = frame->ip - function->chunk.code - 1;
-
-        fprintf(stderr, "[line %d] in ", function->chunk.lines[instruction]);
-        if (function->name == NULL) {
-            fprintf(stderr, "script\n");
-        }
-        else {
-            fprintf(stderr, "%s()\n", function->name->chars);
+        if (i < skipFrom && i >= skipTo) {
+            fprintf(stderr, "... %d more frames\n", skipFrom - skipTo);
+            i = skipTo;
+            continue;
         }
+        printFrame(&vm.frames[i]);
     }
 
     resetStack();
@@ -55,6 +142,12 @@ static void defineNative(const char* name, NativeFn function) {
 }
 
 void initVM() {
+    vm.stack = (Value*)reallocVM(NULL, sizeof(Value) * STACK_INITIAL);
+    vm.stackLimit = vm.stack + STACK_INITIAL;
+    vm.frames = (CallFrame*)reallocVM(NULL, sizeof(CallFrame) * FRAMES_INITIAL);
+    vm.frameCapacity = FRAMES_INITIAL;
+    vm.framesMax = FRAMES_MAX;
+
     resetStack();
     vm.objects = NULL;
 
@@ -77,6 +170,18 @@ void freeVM() {
     freeTable(&vm.strings);
     vm.initString = NULL;
     freeObjects();
+
+    free(vm.stack);
+    vm.stack = NULL;
+    vm.stackTop = NULL;
+    vm.stackLimit = NULL;
+    free(vm.frames);
+    vm.frames = NULL;
+    vm.frameCapacity = 0;
+
+#ifdef DEBUG_COUNT_OPCODES
+    writeOpcodeCounts(OPCODE_COUNTS_PATH);
+#endif
 };
 
 void push(Value value) {
@@ -99,15 +204,22 @@ static bool call(ObjectClosure* closure, int argCount) {
         return false;
     }
 
-    if (vm.frameCount == FRAMES_MAX) {
+    if (vm.frameCount >= vm.framesMax) {
         runtimeError("Stack overflow.");
         return false;
     }
 
-    CallFrame* frame = &vm.frames[vm.frameCount++];
+    if (vm.frameCount == vm.frameCapacity) growFrames();
+    ensureStack(closure->function);
+
+    CallFrame* frame = &vm.frames[vm.frameCount];
     frame->closure = closure;
     frame->ip = closure->function->chunk.code;
     frame->slots = vm.stackTop - argCount - 1;
+    // Keeps the compiler from sinking the stores above past the count the
+    // profiler's signal handler reads.
+    atomic_signal_fence(memory_order_release);
+    vm.frameCount++;
     return true;
 }
 
@@ -226,6 +338,38 @@ static void closeUpValues(Value* last) {
     }
 }
 
+static bool tailCall(ObjectClosure* closure, int argCount) {
+    if (argCount != closure->function->arity) {
+        runtimeError("Expected %d arguments but got %d", closure->function->arity, argCount);
+        return false;
+    }
+
+    ensureStack(closure->function);
+
+    CallFrame* frame = &vm.frames[vm.frameCount - 1];
+    closeUpValues(frame->slots);
+
+    memmove(frame->slots, vm.stackTop - argCount - 1, sizeof(Value) * (argCount + 1));
+    vm.stackTop = frame->slots + argCount + 1;
+    frame->closure = closure;
+    frame->ip = closure->function->chunk.code;
+    return true;
+}
+
+static bool tailCallValue(Value callee, int argCount) {
+    if (IS_BOUND_METHOD(callee)) {
+        ObjectBoundMethod* boundMethod = AS_BOUND_METHOD(callee);
+        vm.stackTop[-argCount - 1] = boundMethod->receiver;
+        return tailCall(boundMethod->method, argCount);
+    }
+
+    if (IS_CLOSURE(callee)) {
+        return tailCall(AS_CLOSURE(callee), argCount);
+    }
+
+    return callValue(callee, argCount);
+}
+
 static void defineMethod(ObjectString* name) {
     Value method = peek(0);
     ObjectClass* loxClass = AS_CLASS(peek(1));
@@ -260,9 +404,9 @@ static InterpretResult run() {
 
 #define READ_SHORT() (frame->ip += 2, (uint16_t)((frame->ip[-2] << 8) | frame->ip[-1]))
 
-#define READ_CONSTANT() (frame->closure->function->chunk.constants.values[READ_BYTE()])
+#define CONSTANT(index) (frame->closure->function->chunk.constants.values[index])
 
-#define READ_STRING() AS_STRING(READ_CONSTANT())
+#define STRING(index) AS_STRING(CONSTANT(index))
 
 #define BINARY_OP(valueType, op) \
     do { \
@@ -279,6 +423,16 @@ static InterpretResult run() {
     printf("\nEXECUTION START\n");
 #endif
 
+#ifdef DEBUG_COUNT_OPCODES
+    beginOpcodeCounts();
+#endif
+
+    // Instructions that index constants, locals or upvalues read a one byte
+    // operand and fall into a labelled body. OP_WIDE jumps to the same body
+    // with a two byte operand, so the common narrow form pays nothing for it.
+    int operand;
+    bool wide;
+
     for (;;) {
 #ifdef DEBUG_TRACE_EXECUTION
         printf("          ");
@@ -297,31 +451,37 @@ static InterpretResult run() {
 
         uint8_t instruction = READ_BYTE();
 
+#ifdef DEBUG_COUNT_OPCODES
+        countOpcode(instruction);
+#endif
+
         switch (instruction)
         {
-        case OP_CONSTANT: {
-            Value constant = READ_CONSTANT();
-            push(constant);
+        case OP_CONSTANT:
+            operand = READ_BYTE();
+        doConstant:
+            push(CONSTANT(operand));
             break;
-        }
         case OP_NIL: push(NIL_VALUE); break;
         case OP_TRUE: push(BOOL_VALUE(true)); break;
         case OP_FALSE: push(BOOL_VALUE(false)); break;
 
         case OP_POP: pop(); break;
 
-        case OP_GET_LOCAL: {
-            uint8_t slot = READ_BYTE();
-            push(frame->slots[slot]);
+        case OP_GET_LOCAL:
+            operand = READ_BYTE();
+        doGetLocal:
+            push(frame->slots[operand]);
             break;
-        }
-        case OP_SET_LOCAL: {
-            uint8_t slot = READ_BYTE();
-            frame->slots[slot] = peek(0);
+        case OP_SET_LOCAL:
+            operand = READ_BYTE();
+        doSetLocal:
+            frame->slots[operand] = peek(0);
             break;
-        }
-        case OP_GET_GLOBAL: {
-            ObjectString* name = READ_STRING();
+        case OP_GET_GLOBAL:
+            operand = READ_BYTE();
+        doGetGlobal: {
+            ObjectString* name = STRING(operand);
             Value value;
             if (!tableGet(&vm.globals, name, &value)) {
                 runtimeError("Undefined variable '%s'.", name->chars);
@@ -330,14 +490,18 @@ static InterpretResult run() {
             push(value);
             break;
         }
-        case OP_DEFINE_GLOBAL: {
-            ObjectString* name = READ_STRING();
+        case OP_DEFINE_GLOBAL:
+            operand = READ_BYTE();
+        doDefineGlobal: {
+            ObjectString* name = STRING(operand);
             tableSet(&vm.globals, name, peek(0));
             pop();
             break;
         }
-        case OP_SET_GLOBAL: {
-            ObjectString* name = READ_STRING();
+        case OP_SET_GLOBAL:
+            operand = READ_BYTE();
+        doSetGlobal: {
+            ObjectString* name = STRING(operand);
             if (tableSet(&vm.globals, name, peek(0))) {
                 tableDelete(&vm.globals, name);
                 runtimeError("Undefined variable '%s'.", name->chars);
@@ -345,24 +509,26 @@ static InterpretResult run() {
             }
             break;
         }
-        case OP_GET_UPVALUE: {
-            uint8_t slot = READ_BYTE();
-            push(*frame->closure->upValues[slot]->location);
+        case OP_GET_UPVALUE:
+            operand = READ_BYTE();
+        doGetUpValue:
+            push(*frame->closure->upValues[operand]->location);
             break;
-        }
-        case OP_SET_UPVALUE: {
-            uint8_t slot = READ_BYTE();
-            *frame->closure->upValues[slot]->location = peek(0);
+        case OP_SET_UPVALUE:
+            operand = READ_BYTE();
+        doSetUpValue:
+            *frame->closure->upValues[operand]->location = peek(0);
             break;
-        }
-        case OP_GET_PROPERTY: {
+        case OP_GET_PROPERTY:
+            operand = READ_BYTE();
+        doGetProperty: {
             if (!IS_INSTANCE(peek(0))) {
                 runtimeError("Only instances have properties.");
                 return INTERPRET_RUNTIME_ERROR;
             }
 
             ObjectInstance* instance = AS_INSTANCE(peek(0));
-            ObjectString* name = READ_STRING();
+            ObjectString* name = STRING(operand);
 
             Value value;
             if (tableGet(&instance->fields, name, &value)) {
@@ -377,21 +543,25 @@ static InterpretResult run() {
 
             break;
         }
-        case OP_SET_PROPERTY: {
+        case OP_SET_PROPERTY:
+            operand = READ_BYTE();
+        doSetProperty: {
             if (!IS_INSTANCE(peek(1))) {
                 runtimeError("Only instances have fields.");
                 return INTERPRET_RUNTIME_ERROR;
             }
 
             ObjectInstance* instance = AS_INSTANCE(peek(1));
-            tableSet(&instance->fields, READ_STRING(), peek(0));
+            tableSet(&instance->fields, STRING(operand), peek(0));
             Value value = pop();
             pop(); // instance
             push(value);
             break;
         }
-        case OP_GET_SUPER: {
-            ObjectString* name = READ_STRING();
+        case OP_GET_SUPER:
+            operand = READ_BYTE();
+        doGetSuper: {
+            ObjectString* name = STRING(operand);
             ObjectClass* superClass = AS_CLASS(pop());
 
             if (!bindMethod(superClass, name)) {
@@ -468,8 +638,18 @@ static InterpretResult run() {
             frame = &vm.frames[vm.frameCount - 1];
             break;
         }
-        case OP_INVOKE: {
-            ObjectString* method = READ_STRING();
+        case OP_TAIL_CALL: {
+            int argCount = READ_BYTE();
+            if (!tailCallValue(peek(argCount), argCount)) {
+                return INTERPRET_RUNTIME_ERROR;
+            }
+            frame = &vm.frames[vm.frameCount - 1];
+            break;
+        }
+        case OP_INVOKE:
+            operand = READ_BYTE();
+        doInvoke: {
+            ObjectString* method = STRING(operand);
             int argCount = READ_BYTE();
             if (!invoke(method, argCount)) {
                 return INTERPRET_RUNTIME_ERROR;
@@ -477,8 +657,10 @@ static InterpretResult run() {
             frame = &vm.frames[vm.frameCount - 1];
             break;
         }
-        case OP_SUPER_INVOKE: {
-            ObjectString* method = READ_STRING();
+        case OP_SUPER_INVOKE:
+            operand = READ_BYTE();
+        doSuperInvoke: {
+            ObjectString* method = STRING(operand);
             int argCount = READ_BYTE();
             ObjectClass* superClass = AS_CLASS(pop());
             if (!invokeFromClass(superClass, method, argCount)) {
@@ -488,13 +670,16 @@ static InterpretResult run() {
             break;
         }
 
-        case OP_CLOSURE: {
-            ObjectFunction* function = AS_FUNCTION(READ_CONSTANT());
+        case OP_CLOSURE:
+            operand = READ_BYTE();
+            wide = false;
+        doClosure: {
+            ObjectFunction* function = AS_FUNCTION(CONSTANT(operand));
             ObjectClosure* closure = newClosure(function);
             push(OBJECT_VALUE(closure));
             for (int i = 0; i < closure->upValueCount; i++) {
                 uint8_t isLocal = READ_BYTE();
-                uint8_t index = READ_BYTE();
+                int index = wide ? READ_SHORT() : READ_BYTE();
 
                 if (isLocal) {
                     closure->upValues[i] = captureUpValue(frame->slots + index);
@@ -525,10 +710,11 @@ static InterpretResult run() {
             frame = &vm.frames[vm.frameCount - 1];
             break;
         }
-        case OP_CLASS: {
-            push(OBJECT_VALUE(newClass(READ_STRING())));
+        case OP_CLASS:
+            operand = READ_BYTE();
+        doClass:
+            push(OBJECT_VALUE(newClass(STRING(operand))));
             break;
-        }
         case OP_INHERIT: {
             Value superClass = peek(1);
             if (!IS_CLASS(superClass)) {
@@ -541,17 +727,48 @@ static InterpretResult run() {
             pop();
             break;
         }
-        case OP_METHOD: {
-            defineMethod(READ_STRING());
+        case OP_METHOD:
+            operand = READ_BYTE();
+        doMethod:
+            defineMethod(STRING(operand));
+            break;
+
+        case OP_WIDE:
+            instruction = READ_BYTE();
+            operand = READ_SHORT();
+            wide = true;
+
+#ifdef DEBUG_COUNT_OPCODES
+            countWideOpcode(instruction);
+#endif
+
+            switch (instruction)
+            {
+            case OP_CONSTANT:       goto doConstant;
+            case OP_GET_LOCAL:      goto doGetLocal;
+            case OP_SET_LOCAL:      goto doSetLocal;
+            case OP_GET_GLOBAL:     goto doGetGlobal;
+            case OP_DEFINE_GLOBAL:  goto doDefineGlobal;
+            case OP_SET_GLOBAL:     goto doSetGlobal;
+            case OP_GET_UPVALUE:    goto doGetUpValue;
+            case OP_SET_UPVALUE:    goto doSetUpValue;
+            case OP_GET_PROPERTY:   goto doGetProperty;
+            case OP_SET_PROPERTY:   goto doSetProperty;
+            case OP_GET_SUPER:      goto doGetSuper;
+            case OP_INVOKE:         goto doInvoke;
+            case OP_SUPER_INVOKE:   goto doSuperInvoke;
+            case OP_CLOSURE:        goto doClosure;
+            case OP_CLASS:          goto doClass;
+            case OP_METHOD:         goto doMethod;
+            }
             break;
-        }
         }
     }
 
 #undef READ_BYTE
 #undef READ_SHORT
-#undef READ_CONSTANT
-#undef READ_STRING
+#undef CONSTANT
+#undef STRING
 #undef BINARY_OP
 }
 
@@ -559,6 +776,10 @@ InterpretResult interpret(const char* source) {
     ObjectFunction* function = compile(source);
     if (function == NULL) return INTERPRET_COMPILE_ERROR;
 
+    return interpretFunction(function);
+};
+
+InterpretResult interpretFunction(ObjectFunction* function) {
     push(OBJECT_VALUE(function));
     ObjectClosure* closure = newClosure(function);
     pop();
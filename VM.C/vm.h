@@ -6,8 +6,15 @@
 #include "table.h"
 #include "value.h"
 
-#define FRAMES_MAX 64
-#define STACK_MAX (FRAMES_MAX * UINT8_COUNT)
+#ifndef FRAMES_MAX
+#define FRAMES_MAX 65536
+#endif
+
+#define FRAMES_INITIAL 8
+// Stack traces list this many frames from each end of the call stack.
+#define TRACE_FRAMES 10
+#define STACK_INITIAL UINT8_COUNT
+#define STACK_HEADROOM 2
 
 typedef struct CallFrame {
 	ObjectClosure* closure;
@@ -16,11 +23,14 @@ typedef struct CallFrame {
 } CallFrame;
 
 typedef struct VM {
-	CallFrame frames[FRAMES_MAX];
+	CallFrame* frames;
 	int frameCount;
+	int frameCapacity;
+	int framesMax;
 
-	Value stack[STACK_MAX];
+	Value* stack;
 	Value* stackTop;
+	Value* stackLimit;
 	Table globals;
 	Table strings;
 	ObjectString* initString;
@@ -45,6 +55,9 @@ extern VM vm;
 void initVM();
 void freeVM();
 InterpretResult interpret(const char* source);
+InterpretResult interpretFunction(ObjectFunction* function);
+int findNative(NativeFn function);
+NativeFn getNative(int index);
 void push(Value value);
 Value pop();
 